@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <zstd.h>
+
+struct ZstdDictionary {
+  long long id = 0;
+  std::string domain;
+  std::string data;
+};
+
+class ContentCodec {
+public:
+  ~ContentCodec();
+
+  void configure(int level, size_t dict_size, size_t training_samples);
+
+  // With trained given, samples the domain's pages and, once enough are
+  // seen, trains a dictionary into it. The dictionary is used only after it
+  // is passed to add_dictionary, so callers can store it first.
+  bool compress(const std::string &domain, const std::string &text,
+                std::string &out, long long &dict_id,
+                ZstdDictionary *trained = nullptr);
+  bool decompress(const void *data, size_t size, long long dict_id,
+                  std::string &out);
+
+  void add_dictionary(const ZstdDictionary &dictionary);
+
+private:
+  struct DomainState {
+    std::vector<std::string> samples;
+    size_t sample_bytes = 0;
+    bool sampling = false;
+    std::list<std::string>::iterator lru;
+    long long dict_id = 0;
+    ZSTD_CDict *cdict = nullptr;
+    bool training = false;
+  };
+
+  bool train(const std::string &domain, std::vector<std::string> samples,
+             ZstdDictionary &dictionary);
+  void drop_samples(DomainState &state);
+
+  int level_ = 3;
+  size_t dict_size_ = 32 * 1024;
+  size_t training_samples_ = 32;
+  long long next_dict_id_ = 1;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, DomainState> domains_;
+  // Domains holding samples, most recently sampled first. Past
+  // kMaxTotalSampleBytes the coldest lose theirs.
+  std::list<std::string> sampling_;
+  size_t sample_bytes_ = 0;
+  std::unordered_map<long long, ZSTD_DDict *> ddicts_;
+};
\ No newline at end of file
@@ -2,10 +2,17 @@
 #include "../libs/parallel_scheduler/parallel_scheduler.h"
 #include "crawler_config.h"
 #include "database.h"
+#include "html_tokenizer.h"
 #include "htmlparser.h"
 #include "includes.h"
 #include "metrics_collector.h"
+#include "partition_exchange.h"
+#include "recrawl_scheduler.h"
+#include "response_archive.h"
 #include "robots_parser.h"
+#include "seed_loader.h"
+#include "sitemap_parser.h"
+#include "trap_detector.h"
 #include "url_priority.h"
 #include "url_utils.h"
 #include <queue>
@@ -20,6 +27,7 @@ public:
   ~Crawler();
   void load_links_from_file(const std::string &filename);
   void run(size_t size);
+  void set_exchange(std::unique_ptr<PartitionExchange> exchange);
 
   void print_performance_report(std::ostream &os = std::cout);
   void reset_metrics();
@@ -31,15 +39,37 @@ private:
   void process(const std::string &current_link, int depth = 0);
   void process_remaining_links();
   bool fetch_page(const std::string &url, std::string &content);
-  void parse_page(const std::string &content,
-                  std::unordered_set<std::string> &links, std::string &text,
-                  int mode, const std::string &base_url);
-  void save_to_database(const std::string &url, const std::string &text);
+  double parse_page(const std::string &content, ParsedPage &page,
+                    const std::string &base_url);
+  void archive_response(const std::string &url, const std::string &content,
+                        const PageFetchInfo &info);
+  void save_to_database(const std::string &url, const std::string &text,
+                        const PageFetchInfo &info = PageFetchInfo());
   bool fetch_page_with_retry(const std::string &url, std::string &content,
-                             int max_retries = 3, int retry_delay_sec = 5);
+                             int max_retries = 3, int retry_delay_sec = 5,
+                             HtmlTokenizer *stream = nullptr,
+                             PageFetchInfo *info = nullptr);
   bool fetch_page_with_http_code(const std::string &url, std::string &content,
-                                 long *http_code);
+                                 long *http_code,
+                                 HtmlTokenizer *stream = nullptr,
+                                 PageFetchInfo *info = nullptr,
+                                 std::string *abort_reason = nullptr);
+  void load_known_pages();
+  void schedule_revisit(const RevisitPlan &plan);
+  void reschedule_revisit(const std::string &url, long long fetched_at);
+  void queue_due_revisits(long long now);
+  void discover_sitemaps(const std::string &url);
+  bool fetch_sitemap(const std::string &url, SitemapParser &parser,
+                     const bool &stop);
+  bool enqueue_sitemap_entry(const SitemapEntry &entry, long long now);
   void add_to_queue(const std::string &url, int depth, double priority = 0.0);
+  void enqueue_links(const std::vector<std::string> &links, int depth);
+  bool admit_link(const std::string &link);
+  bool in_seed_domains(const std::string &link) const;
+  void enqueue_remote(const std::string &url, int depth);
+  bool mark_fetched(const std::string &url, const std::string &storage_url,
+                    const PageFetchInfo &info, int depth);
+  bool wait_for_remote_links(std::unique_lock<std::mutex> &lock);
 
   void start_metrics_reporting();
   void stop_metrics_reporting();
@@ -54,9 +84,27 @@ private:
   std::unordered_map<std::string, int> url_depths;
 
   std::unordered_set<std::string> visited_links;
+  // Roots of seed sites whose sitemaps have not been read yet.
   std::unordered_set<std::string> main_links;
+  std::unordered_set<std::string> sitemaps_seen;
+  size_t sitemap_files = 0;
+  // Hosts of the seeds, and every parent domain of those hosts.
+  std::unordered_set<std::string> seed_hosts;
+  std::unordered_set<std::string> seed_parent_domains;
+  std::unordered_set<std::string> forwarded_links;
+  std::unordered_set<std::string> fetched_links;
+  std::priority_queue<RevisitPlan, std::vector<RevisitPlan>, RevisitPlanLater>
+      revisits;
+  std::unordered_map<std::string, long long> next_revisit;
+  std::unordered_map<std::string, double> revisit_rates;
+  std::unordered_set<std::string> revisit_links;
   std::mutex queue_mutex;
+  std::condition_variable queue_cv;
+  std::unique_ptr<PartitionExchange> exchange;
+  bool waiting_for_links = false;
   Database db;
+  RecrawlScheduler recrawl;
+  ResponseArchive archive;
   HTMLParser parser;
   parallel_scheduler *scheduler;
   size_t links_size;
@@ -64,6 +112,8 @@ private:
   std::condition_variable task_cv;
   size_t active_tasks = 0;
   RobotsParser robots_parser;
+  TrapDetector trap_detector;
+  UrlPrioritizer prioritizer;
   std::string user_agent;
   std::unordered_map<std::string,
                      std::chrono::time_point<std::chrono::steady_clock>>
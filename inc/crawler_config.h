@@ -7,16 +7,58 @@ struct CrawlerConfig {
   size_t thread_count = 10;
 
   std::string db_name = "parser.db";
+  size_t db_batch_size = 500;
+  int db_batch_ms = 200;
+  size_t db_writer_queue_size = 4096;
+  size_t db_cache_kb = 64 * 1024;
+  bool compress_content = true;
+  int zstd_level = 3;
+  size_t zstd_dict_size = 32 * 1024;
+  size_t zstd_dict_training_samples = 32;
+  std::string fts_index = "insert";
+
+  std::string archive_dir;
+  size_t archive_segment_mb = 1024;
+  int archive_level = 3;
 
   std::string user_agent = "MyWebCrawler/1.0";
   int request_timeout_sec = 30;
 
   size_t max_links = 1000;
 
+  bool use_sitemaps = true;
+  size_t sitemap_max_files = 50;
+  double sitemap_priority_weight = 2.0;
+  double sitemap_freshness_weight = 2.0;
+
+  bool compressed_transfer = true;
+  bool incremental = false;
+  size_t recrawl_daily_budget = 0;
+  double recrawl_default_interval_hours = 24;
+  double recrawl_min_interval_hours = 1;
+  double recrawl_max_interval_hours = 24 * 30;
+  double recrawl_target_change_probability = 0.5;
+
+  size_t max_body_bytes = 10 * 1024 * 1024;
+  std::vector<std::string> allowed_content_types = {"text/",
+                                                    "application/xhtml+xml"};
+
+  std::vector<std::string> strip_query_params = {
+      "utm_*", "gclid",     "fbclid",     "msclkid",      "sessionid",
+      "sid",   "phpsessid", "jsessionid", "aspsessionid*", "session_id"};
+  bool sort_query_params = true;
+
+  size_t trap_max_url_length = 2048;
+  size_t trap_max_path_depth = 16;
+  size_t trap_max_repeated_segments = 3;
+  size_t trap_max_urls_per_template = 1000;
+  size_t trap_max_param_values = 200;
+
   int max_retries = 3;
   int retry_delay_sec = 5;
 
   std::string log_filename = "logs.txt";
+  std::string report_filename = "performance_report.txt";
   bool verbose_logging = true;
 
   std::unordered_map<std::string, std::vector<std::string>> domain_keywords;
@@ -25,5 +67,12 @@ struct CrawlerConfig {
 
   double cross_domain_keyword_weight = 1.5;
 
+  bool gumbo_arena = true;
+  bool streaming_parse = true;
+
+  size_t partition_count = 1;
+  size_t partition_id = 0;
+  size_t partition_batch_size = 256;
+
   static CrawlerConfig load_from_file(const std::string &filename);
 };
\ No newline at end of file
@@ -1,20 +1,145 @@
 #pragma once
+#include "content_codec.h"
 #include "includes.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #define CRAWLER 1
 #define SEARCHER 0
+#define CRAWLER_INCREMENTAL 2
+
+struct PageFetchInfo {
+  std::string etag;
+  std::string last_modified;
+  long http_status = 0;
+  long long fetched_at = 0;
+  size_t body_bytes = 0;
+  double parse_ms = 0;
+  std::string effective_url;
+  std::vector<std::string> redirect_chain;
+  std::string headers;
+};
+
+enum class FtsMode { OFF, ON_INSERT, BULK };
+
+struct PageHistorySummary {
+  std::string url;
+  size_t visits = 0;
+  size_t changes = 0;
+  long long first_fetched = 0;
+  long long last_fetched = 0;
+};
 
 class Database {
 public:
   void connect(const std::string &db_name, int mode);
   void create_table();
   bool is_url_processed(const std::string &url);
-  void insert_page(const std::string &url, const std::string &text);
+  void insert_page(const std::string &url, const std::string &text,
+                   const PageFetchInfo &info = PageFetchInfo());
+  void upsert_page(const std::string &url, const std::string &text,
+                   const PageFetchInfo &info);
+  void mark_not_modified(const std::string &url, const PageFetchInfo &info);
+  bool get_fetch_info(const std::string &url, PageFetchInfo &info);
+  std::vector<std::string> get_page_urls();
+  size_t scan_pages(
+      const std::function<void(const std::string &, const std::string &)>
+          &callback);
+  void record_fetch(const std::string &url, long long fetched_at,
+                    uint64_t content_hash, bool not_modified);
+  std::vector<PageHistorySummary> get_history_summaries();
+  size_t count_fetches_since(long long since);
+  void set_batching(size_t batch_rows, int batch_ms);
+  void set_cache_size(size_t cache_kb);
+  void set_compression(bool enabled, int level, size_t dict_size,
+                       size_t training_samples);
+  bool get_page_text(const std::string &url, std::string &text);
+  static FtsMode parse_fts_mode(const std::string &mode);
+  void set_fts_mode(FtsMode mode);
+  void build_fts();
+  bool has_table(const std::string &name);
+  long long data_version();
+  void refresh_dictionaries(long long version);
+  void start_writer(size_t queue_capacity);
+  void stop_writer();
+  void flush();
   sqlite3 *get_db();
   ~Database();
 
 private:
-  sqlite3 *db;
+  struct PendingWrite {
+    enum Kind { INSERT, UPSERT, NOT_MODIFIED, HISTORY, DICTIONARY };
+
+    PendingWrite(Kind kind, const std::string &url, const std::string &text,
+                 const PageFetchInfo &info)
+        : kind(kind), url(url), text(text), info(info) {}
+
+    Kind kind;
+    std::string url;
+    std::string text;
+    PageFetchInfo info;
+    uint64_t content_hash = 0;
+    bool not_modified = false;
+    std::string compressed;
+    long long dict_id = 0;
+  };
+
+  void add_missing_columns();
+  void load_dictionaries();
+  void register_functions();
+  static void page_text_function(sqlite3_context *context, int argc,
+                                 sqlite3_value **argv);
+  static void url_site_function(sqlite3_context *context, int argc,
+                                sqlite3_value **argv);
+  void encode_content(PendingWrite &write);
+  bool decompress_content(const void *data, size_t size, long long dict_id,
+                          std::string &text);
+  sqlite3_stmt *cached_statement(const char *sql);
+  void submit(PendingWrite write);
+  void writer_loop();
+  void apply(const PendingWrite &write);
+  void write_page(const char *sql, const PendingWrite &write);
+  void write_not_modified(const PendingWrite &write);
+  void write_history(const PendingWrite &write);
+  void write_dictionary(const PendingWrite &write);
+  void index_page(long long id, const std::string &text);
+  long long unindex_page(const std::string &normalized_url);
+  void populate_fts();
+  void begin_write();
+  void end_write();
+  void commit();
+
+  sqlite3 *db = nullptr;
+  std::mutex mutex_;
+  std::unordered_map<std::string, sqlite3_stmt *> statements_;
+  ContentCodec codec_;
+  long long dictionaries_version_ = -1;
+  bool compress_ = false;
+  FtsMode fts_mode_ = FtsMode::OFF;
+  size_t batch_rows_ = 1;
+  int batch_ms_ = 0;
+  size_t pending_rows_ = 0;
+  bool in_transaction_ = false;
+  std::chrono::steady_clock::time_point batch_started_;
+
+  std::unique_ptr<std::thread> writer_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_not_empty_;
+  std::condition_variable queue_not_full_;
+  std::condition_variable writer_idle_;
+  std::deque<PendingWrite> write_queue_;
+  size_t queue_capacity_ = 0;
+  size_t writes_in_flight_ = 0;
+  size_t flush_waiters_ = 0;
+  bool stop_writer_ = false;
 };
 
 class StmtGuard {
@@ -29,4 +154,17 @@ private:
   sqlite3_stmt *stmt_;
   StmtGuard(const StmtGuard &) = delete;
   StmtGuard &operator=(const StmtGuard &) = delete;
+};
+
+class CachedStmt {
+public:
+  CachedStmt(sqlite3_stmt *stmt);
+  ~CachedStmt();
+
+  operator sqlite3_stmt *();
+
+private:
+  sqlite3_stmt *stmt_;
+  CachedStmt(const CachedStmt &) = delete;
+  CachedStmt &operator=(const CachedStmt &) = delete;
 };
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+
+class HtmlScanner {
+public:
+  enum CharSet { TEXT_SPECIAL, TAG_DELIMITER };
+
+  static const char *find(const char *begin, const char *end, CharSet set);
+
+  static const char *backend_name();
+};
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include "htmlparser.h"
+#include <cstddef>
+#include <string>
+
+class HtmlTokenizer {
+public:
+  HtmlTokenizer(ParsedPage &page, const std::string &base_url);
+
+  void set_base_url(const std::string &base_url);
+
+  void feed(const char *data, size_t size);
+  void finish();
+  void reset();
+
+private:
+  enum class State { TEXT, COMMENT, RAW_TEXT };
+
+  size_t process(const char *begin, const char *end, bool final);
+  const char *parse_markup(const char *p, const char *end, bool final);
+  const char *parse_start_tag(const char *p, const char *end, bool final);
+  const char *parse_entity(const char *p, const char *end, bool final);
+  const char *skip_comment(const char *p, const char *end);
+  const char *skip_raw_text(const char *p, const char *end, bool final);
+
+  void append_run(const char *p, const char *end);
+  void append_text(const char *data, size_t size);
+  void append_space();
+  void add_link(const std::string &href);
+
+  ParsedPage &page_;
+  std::string initial_base_url_;
+  std::string base_url_;
+  std::string pending_;
+
+  State state_ = State::TEXT;
+  const char *raw_tag_ = nullptr;
+  int comment_dashes_ = 0;
+  bool last_was_whitespace_ = true;
+  bool in_title_ = false;
+  bool base_seen_ = false;
+};
\ No newline at end of file
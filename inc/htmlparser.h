@@ -2,6 +2,18 @@
 #include <string>
 #include <unordered_set>
 
+struct ParsedPage {
+  std::unordered_set<std::string> links;
+  std::string text;
+  std::string title;
+  std::string canonical;
+  bool noindex = false;
+  bool nofollow = false;
+
+  // Applies the content of a meta robots tag, shared by both parsers.
+  void apply_robots_directives(const std::string &content);
+};
+
 class HTMLParser {
 public:
     HTMLParser();
@@ -12,4 +24,11 @@ public:
     std::unordered_set<std::string> extract_links(const std::string& html, const std::string& base_url);
     
     std::string extract_text(const std::string& html);
+
+    ParsedPage parse(const std::string& html, const std::string& base_url);
+
+    void set_use_arena(bool enabled) { use_arena_ = enabled; }
+
+private:
+    bool use_arena_ = true;
 };
\ No newline at end of file
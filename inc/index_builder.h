@@ -0,0 +1,48 @@
+#pragma once
+#include "inverted_index.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class IndexBuilder {
+public:
+  IndexBuilder(const std::string &dir, size_t segment_docs);
+
+  bool add_document(const std::string &url, const std::string &text);
+  bool finish();
+
+  size_t doc_count() const { return total_docs_; }
+  size_t segment_count() const { return segments_.size(); }
+  uint64_t index_bytes() const { return index_bytes_; }
+
+private:
+  struct Posting {
+    uint32_t doc;
+    uint32_t tf;
+  };
+
+  // positions holds tf word positions per posting, in posting order.
+  struct TermPostings {
+    std::vector<Posting> postings;
+    std::vector<uint32_t> positions;
+  };
+
+  bool flush_segment();
+  static void encode_postings(const TermPostings &term,
+                              const std::vector<uint32_t> &lengths,
+                              TermEntry &entry, std::string &out,
+                              std::string &positions);
+
+  std::string dir_;
+  size_t segment_docs_;
+  uint64_t generation_ = 1;
+  size_t total_docs_ = 0;
+  uint64_t index_bytes_ = 0;
+  std::vector<std::string> segments_;
+
+  std::vector<std::string> urls_;
+  std::vector<uint32_t> lengths_;
+  std::unordered_map<std::string, TermPostings> postings_;
+  std::vector<std::string> terms_;
+  std::vector<uint32_t> order_;
+};
\ No newline at end of file
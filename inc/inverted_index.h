@@ -0,0 +1,225 @@
+#pragma once
+#include "postings_codec.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// On-disk layout of one immutable index segment. All integers are
+// little-endian; offsets are absolute file offsets.
+//
+//   SegmentHeader
+//   doc table:  uint64 url_offsets[doc_count + 1], uint32 lengths[doc_count],
+//               url bytes
+//   term table: TermEntry[term_count] sorted by term bytes, term bytes
+//   postings:   per term, a skip table with one SkipEntry per block, then
+//               for each block the delta-coded doc IDs followed by the term
+//               frequencies, both as PostingsCodec blocks, with varints for
+//               the partial tail block
+//   positions:  per term and block, the word positions of each posting as
+//               varint deltas; only phrase and proximity queries read them
+//
+// Besides its words, every page is indexed under "site:<host>" for its
+// host and each parent domain, so site: restrictions are posting lists.
+//
+// An index directory holds the segments and a MANIFEST naming them.
+// kIndexFormatVersion changes whenever this layout changes; readers reject
+// segments written with a different version and ask for a rebuild.
+//
+//   1  doc IDs only
+//   2  term frequencies, document lengths and per-block score bounds
+//   3  word positions
+//   4  site terms
+
+static const uint32_t kIndexFormatVersion = 4;
+
+struct SegmentHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t block_size;
+  uint64_t doc_count;
+  uint64_t term_count;
+  uint64_t total_length;
+  uint64_t docs_offset;
+  uint64_t lengths_offset;
+  uint64_t terms_offset;
+  uint64_t term_bytes_offset;
+  uint64_t postings_offset;
+  uint64_t positions_offset;
+};
+
+// max_tf and min_length bound the BM25 contribution of every posting in a
+// term or block: the score grows with tf and shrinks with document length.
+struct TermEntry {
+  uint64_t term_offset;
+  uint64_t postings_offset;
+  uint64_t positions_offset;
+  uint32_t term_length;
+  uint32_t doc_freq;
+  uint32_t max_tf;
+  uint32_t min_length;
+};
+
+struct SkipEntry {
+  uint32_t last_doc;
+  uint32_t block_offset;
+  uint32_t positions_offset;
+  uint32_t max_tf;
+  uint32_t min_length;
+};
+
+class TermTokenizer {
+public:
+  static const size_t kMaxTermLength = 64;
+
+  static void tokenize(const std::string &text,
+                       std::vector<std::string> &terms);
+  static std::string site_term(const std::string &host);
+  static void site_terms(const std::string &url,
+                         std::vector<std::string> &terms);
+};
+
+class IndexSegment {
+public:
+  IndexSegment() = default;
+  ~IndexSegment();
+
+  bool open(const std::string &path, std::string *error = nullptr);
+
+  size_t doc_count() const { return header_->doc_count; }
+  uint64_t total_length() const { return header_->total_length; }
+  uint32_t doc_length(uint32_t doc) const { return lengths_[doc]; }
+  std::string url(uint32_t doc) const;
+  const TermEntry *find(const std::string &term) const;
+  const uint8_t *postings(const TermEntry &entry) const {
+    return data_ + entry.postings_offset;
+  }
+  const uint8_t *positions(const TermEntry &entry) const {
+    return data_ + entry.positions_offset;
+  }
+
+private:
+  IndexSegment(const IndexSegment &) = delete;
+  IndexSegment &operator=(const IndexSegment &) = delete;
+
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  const SegmentHeader *header_ = nullptr;
+  const uint64_t *url_offsets_ = nullptr;
+  const uint32_t *lengths_ = nullptr;
+  const char *urls_ = nullptr;
+  const TermEntry *terms_ = nullptr;
+  const char *term_bytes_ = nullptr;
+};
+
+class PostingCursor {
+public:
+  static const uint32_t kEnd = UINT32_MAX;
+
+  PostingCursor(const IndexSegment &segment, const TermEntry &entry);
+
+  uint32_t doc() const { return doc_; }
+  uint32_t doc_freq() const { return entry_->doc_freq; }
+  uint32_t freq();
+  void positions(std::vector<uint32_t> &out);
+  uint32_t next();
+  uint32_t next_geq(uint32_t target);
+
+  // Moves only the block-level position: returns the last doc of the first
+  // block that can hold target, without decoding it.
+  uint32_t shallow_seek(uint32_t target);
+  const SkipEntry &shallow_block() const { return skip(shallow_); }
+  const TermEntry &entry() const { return *entry_; }
+
+  // The decoded docs of the current block from doc() on, the last of which
+  // is block_last(), or kEnd at the end of the list.
+  const uint32_t *block_docs() const { return docs_ + position_; }
+  size_t block_left() const {
+    return doc_ == kEnd ? 0 : block_length_ - position_;
+  }
+  uint32_t block_last() const {
+    return doc_ == kEnd ? kEnd : docs_[block_length_ - 1];
+  }
+
+  size_t decoded() const { return decoded_; }
+
+private:
+  void load_block(size_t block);
+  const SkipEntry &skip(size_t block) const { return skips_[block]; }
+
+  const TermEntry *entry_;
+  const SkipEntry *skips_ = nullptr;
+  const uint8_t *blocks_ = nullptr;
+  const uint8_t *freqs_ = nullptr;
+  const uint8_t *positions_ = nullptr;
+  const uint8_t *position_data_ = nullptr;
+  const uint8_t *current_positions_ = nullptr;
+  size_t positions_read_ = 0;
+  size_t block_count_ = 0;
+  size_t block_ = 0;
+  size_t shallow_ = 0;
+  size_t block_length_ = 0;
+  size_t position_ = 0;
+  bool freqs_decoded_ = false;
+  size_t decoded_ = 0;
+  uint32_t doc_ = kEnd;
+  uint32_t docs_[PostingsCodec::kBlockSize];
+  uint32_t tfs_[PostingsCodec::kBlockSize];
+};
+
+struct IndexHit {
+  size_t segment;
+  uint32_t doc;
+  double score;
+};
+
+// A parsed query. Leaves are phrases (a single word is a one-word phrase)
+// and site restrictions, which match the pages of a host and its
+// subdomains. NEAR joins two phrases that occur with at most `distance`
+// other words between them, in either order. NOT only has a meaning as a
+// child of AND, where it excludes the pages its own child matches.
+struct IndexQuery {
+  enum Kind { PHRASE, SITE, NEAR, AND, OR, NOT };
+
+  Kind kind = AND;
+  std::vector<std::string> terms;
+  uint32_t distance = 0;
+  std::vector<IndexQuery> children;
+
+  bool empty() const {
+    return kind == PHRASE || kind == SITE ? terms.empty() : children.empty();
+  }
+  // Every phrase word of the query, sorted and without duplicates.
+  std::vector<std::string> terms_used() const;
+  std::string to_string() const;
+};
+
+struct IndexQueryStats {
+  size_t postings = 0;
+  size_t decoded = 0;
+  size_t scored = 0;
+  size_t positions = 0;
+};
+
+class InvertedIndex {
+public:
+  bool open(const std::string &dir, std::string *error = nullptr);
+
+  // Returns the limit best matches of the query by BM25, best first.
+  std::vector<IndexHit> search(const IndexQuery &query, size_t limit,
+                               IndexQueryStats *stats = nullptr) const;
+  std::string url(const IndexHit &hit) const;
+  uint64_t generation() const { return generation_; }
+  size_t doc_count() const { return doc_count_; }
+
+  static bool read_manifest(const std::string &dir, uint64_t &generation,
+                            std::vector<std::string> &segments,
+                            std::string *error = nullptr);
+
+private:
+  uint64_t generation_ = 0;
+  size_t doc_count_ = 0;
+  double avg_length_ = 0;
+  std::vector<std::unique_ptr<IndexSegment>> segments_;
+};
\ No newline at end of file
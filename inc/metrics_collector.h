@@ -42,9 +42,27 @@ public:
   void set_visited_count(size_t count);
 
   double get_urls_per_second();
-  double get_bandwidth_usage();
+  struct TransferBytes {
+    size_t wire = 0;
+    size_t decoded = 0;
+  };
+
+  double get_bandwidth_usage(bool decoded = false);
+
+  void add_bytes_downloaded(size_t wire_bytes, size_t decoded_bytes,
+                            const std::string &domain = "");
+
+  void increment_counter(const std::string &name, size_t delta = 1);
+  size_t get_counter(const std::string &name);
+
+  struct Gauge {
+    size_t last = 0;
+    size_t peak = 0;
+    size_t samples = 0;
+    double total = 0;
+  };
 
-  void add_bytes_downloaded(size_t bytes);
+  void record_gauge(const std::string &name, size_t value);
 
 private:
   MetricsCollector() = default;
@@ -58,10 +76,14 @@ private:
                      std::chrono::high_resolution_clock::time_point>
       timers_;
   std::unordered_map<std::string, std::string> active_urls_;
+  std::unordered_map<std::string, size_t> counters_;
+  std::unordered_map<std::string, Gauge> gauges_;
+  std::unordered_map<std::string, TransferBytes> domain_bytes_;
 
   std::atomic<size_t> active_threads_{0};
   std::atomic<size_t> queue_size_{0};
   std::atomic<size_t> visited_count_{0};
   std::chrono::high_resolution_clock::time_point start_time_;
-  std::atomic<size_t> total_bytes_downloaded_{0};
+  std::atomic<size_t> total_wire_bytes_{0};
+  std::atomic<size_t> total_decoded_bytes_{0};
 };
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PartitionExchange {
+public:
+  using Receiver = std::function<void(const std::string &url, int depth)>;
+  // Whether the crawler has nothing to do until a link arrives.
+  using IdleCheck = std::function<bool()>;
+  // Called once every partition is idle and no links are in flight.
+  using Finished = std::function<void()>;
+
+  PartitionExchange(const std::string &group, size_t partition_id,
+                    size_t partition_count, int socket_fd,
+                    size_t batch_size = 256);
+  ~PartitionExchange();
+
+  static std::vector<int> bind_sockets(const std::string &group,
+                                       size_t partition_count);
+  static size_t partition_for(const std::string &url, size_t partition_count);
+
+  bool owns(const std::string &url) const;
+  void send(const std::string &url, int depth);
+  void flush();
+
+  void start(Receiver receiver, IdleCheck idle, Finished finished);
+  void stop();
+
+  bool finished() const { return finished_; }
+  size_t sent_count() const { return sent_; }
+  size_t received_count() const { return received_; }
+  size_t dropped_count() const { return dropped_; }
+
+private:
+  struct Outbox {
+    std::mutex mutex;
+    std::string batch;
+    size_t count = 0;
+  };
+
+  void flush_outbox(size_t partition);
+  void report();
+  void handle_control(const char *message, size_t length);
+  void receive_loop();
+  void flush_loop();
+
+  std::string group_;
+  size_t partition_id_;
+  size_t partition_count_;
+  int socket_fd_;
+  int send_fd_;
+  size_t batch_size_;
+
+  std::vector<std::unique_ptr<Outbox>> outboxes_;
+  Receiver receiver_;
+  IdleCheck idle_;
+  Finished finished_callback_;
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> finished_{false};
+  std::thread receive_thread_;
+  std::thread flush_thread_;
+  std::atomic<size_t> sent_{0};
+  std::atomic<size_t> received_{0};
+  std::atomic<size_t> dropped_{0};
+};
+
+// Runs in the parent of the partitions and decides when the crawl is over.
+// Every partition reports whether it is idle together with how many URLs it
+// has sent and received. Reports are collected in waves; the crawl is over
+// when two consecutive waves find every partition idle with unchanged
+// counters and as many URLs received as sent, so none can be in flight.
+class PartitionCoordinator {
+public:
+  PartitionCoordinator(const std::string &group, size_t partition_count);
+  ~PartitionCoordinator();
+
+  bool bind();
+  // Reads reports for up to timeout_ms; true once the crawl is over.
+  bool poll(int timeout_ms);
+  // Tells every partition to stop.
+  void finish();
+
+private:
+  struct Report {
+    bool seen = false;
+    bool idle = false;
+    size_t sent = 0;
+    size_t received = 0;
+  };
+
+  void handle_report(const char *message, size_t length);
+  bool quiescent() const;
+
+  std::string group_;
+  size_t partition_count_;
+  int socket_fd_ = -1;
+  std::vector<Report> wave_;
+  std::vector<Report> last_wave_;
+  size_t wave_size_ = 0;
+  bool terminated_ = false;
+};
\ No newline at end of file
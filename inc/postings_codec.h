@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class PostingsCodec {
+public:
+  static const size_t kBlockSize = 128;
+
+  static void encode_block(const uint32_t *values, std::string &out);
+  static const uint8_t *decode_block(const uint8_t *in, uint32_t *values);
+
+  static void encode_varints(const uint32_t *values, size_t count,
+                             std::string &out);
+  static const uint8_t *decode_varints(const uint8_t *in, size_t count,
+                                       uint32_t *values);
+
+  static void put_varint(uint32_t value, std::string &out);
+  static const uint8_t *get_varint(const uint8_t *in, uint32_t &value);
+};
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Set operations on sorted, duplicate-free doc ID arrays. The widest
+// implementation the CPU supports (AVX2, SSE4.1 or plain C++) is picked on
+// first use. Outputs must not overlap the inputs and need kPadding spare
+// entries, since vector stores may write past the last result.
+class PostingsKernels {
+public:
+  static const size_t kPadding = 8;
+
+  enum Backend { SCALAR, SSE41, AVX2 };
+
+  // MERGE walks both lists; SHUFFLE compares a vector of each list against
+  // every rotation of the other, for lists of similar length; V1 and V3
+  // scan the longer list a vector or four at a time for each element of
+  // the shorter one; GALLOP searches the longer list with doubling steps,
+  // for very different lengths. AUTO picks by the ratio of the lengths.
+  enum Algorithm { AUTO, MERGE, SHUFFLE, V1, V3, GALLOP };
+
+  static size_t intersect(const uint32_t *a, size_t a_size, const uint32_t *b,
+                          size_t b_size, uint32_t *out,
+                          Algorithm algorithm = AUTO);
+
+  static size_t unite(const uint32_t *a, size_t a_size, const uint32_t *b,
+                      size_t b_size, uint32_t *out);
+  // Unites lists pairwise, smallest first, using scratch for the rounds.
+  static size_t unite(const uint32_t *const *lists, const size_t *sizes,
+                      size_t count, uint32_t *out,
+                      std::vector<uint32_t> &scratch);
+
+  // Switches to a backend, for benchmarks; false if the CPU lacks it.
+  static bool use_backend(Backend backend);
+  static const char *backend_name();
+};
\ No newline at end of file
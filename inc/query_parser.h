@@ -0,0 +1,55 @@
+#pragma once
+#include "inverted_index.h"
+#include <string>
+#include <vector>
+
+// Parses the searcher's query language into an IndexQuery:
+//
+//   chocolate cake               both words (either one when match_all is
+//                                false)
+//   chocolate OR vanilla         either word
+//   cake NOT cheese, NOT cheese  pages without the word
+//   (cake OR pie) AND apple      grouping; AND may be left out
+//   "chocolate cake"             the words as a phrase
+//   cake NEAR/5 chocolate        at most 5 words apart; NEAR means NEAR/10
+//   site:example.com             pages of example.com and its subdomains
+//
+// Operators are upper case and bind NEAR, NOT, AND, OR from tightest to
+// loosest. Parsing never fails: stray operators and parentheses are
+// ignored, as are parentheses nested deeper than kMaxDepth and everything
+// past the first kMaxTokens words, phrases and parentheses. The caps bound
+// the recursion here and in whatever walks the tree.
+class QueryParser {
+public:
+  static constexpr uint32_t kDefaultNearDistance = 10;
+  static constexpr int kMaxDepth = 32;
+  static constexpr size_t kMaxTokens = 256;
+
+  static IndexQuery parse(const std::string &query, bool match_all = true);
+
+private:
+  struct Token {
+    enum Kind { WORD, PHRASE, OPEN, CLOSE };
+    Kind kind;
+    std::string text;
+  };
+
+  QueryParser(const std::string &query, bool match_all);
+
+  bool parse_group(IndexQuery &out);
+  bool parse_or(IndexQuery &out);
+  bool parse_and(IndexQuery &out);
+  bool parse_near(IndexQuery &out);
+  bool parse_primary(IndexQuery &out);
+  bool accept(const char *keyword);
+  bool near_operator(uint32_t &distance) const;
+  bool stop() const;
+
+  static bool is_operator(const std::string &word);
+  static void add_child(IndexQuery &parent, IndexQuery child);
+  static IndexQuery simplify(IndexQuery query);
+
+  std::vector<Token> tokens_;
+  size_t pos_ = 0;
+  bool match_all_;
+};
\ No newline at end of file
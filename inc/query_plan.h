@@ -0,0 +1,76 @@
+#pragma once
+#include "inverted_index.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+double bm25_score(double idf, uint32_t tf, uint32_t length, double avg_length);
+
+// Iterates the matches of one query node within one segment, in doc order,
+// in two phases: next_geq() stops at every doc that has all the terms the
+// node needs, and matches() then checks word positions and exclusions, so
+// a parent only pays for them on docs its other children also contain.
+class QueryIterator {
+public:
+  virtual ~QueryIterator() = default;
+
+  uint32_t doc() const { return doc_; }
+  // Upper bound on the number of matches, used to order intersections.
+  uint64_t cost() const { return cost_; }
+
+  // Moves to the first candidate at or after target, or PostingCursor::kEnd.
+  virtual uint32_t next_geq(uint32_t target) = 0;
+  // Whether the current candidate really matches.
+  virtual bool matches() { return true; }
+  // BM25 score of the current candidate once it matches.
+  virtual double score() = 0;
+  // Bounds the score of any match from target up to block_end from the
+  // skip tables alone. Returns false when nothing from target on matches.
+  virtual bool block_bound(uint32_t target, double &bound,
+                           uint32_t &block_end) = 0;
+
+  // Candidates a block at a time: window_end() is the last doc up to which
+  // the iterator knows its candidates from the blocks it has decoded, and
+  // window() points docs at them from doc() through end, at most
+  // window_end(), until it is next called. Iterators that cannot return
+  // false.
+  virtual uint32_t window_end() const { return doc_; }
+  virtual bool window(uint32_t, const uint32_t *&, size_t &) { return false; }
+
+protected:
+  uint32_t doc_ = 0;
+  uint64_t cost_ = 0;
+};
+
+class TermIterator;
+class PhraseIterator;
+
+// Compiles a query into iterators over one segment. Intersections are led
+// by their rarest child, whose candidates the others reach by skipping
+// ahead in their own lists; when the lists are of similar length, the
+// blocks all of them have decoded around a candidate are intersected and
+// united at once with PostingsKernels. NOT becomes a probe of the excluded
+// list at each candidate; site: restrictions are unscored term lists.
+class QueryPlanner {
+public:
+  QueryPlanner(const IndexSegment &segment,
+               const std::map<std::string, double> &idf, double avg_length,
+               IndexQueryStats &stats);
+
+  // Returns nullptr when nothing in the segment can match.
+  std::unique_ptr<QueryIterator> plan(const IndexQuery &query);
+  // Postings decoded so far by the planned iterators, which must still exist.
+  size_t decoded() const;
+
+private:
+  std::unique_ptr<TermIterator> term(const std::string &term, double idf);
+  std::unique_ptr<PhraseIterator> phrase(const IndexQuery &query);
+  double idf(const std::string &term) const;
+
+  const IndexSegment &segment_;
+  const std::map<std::string, double> &idf_;
+  double avg_length_;
+  IndexQueryStats &stats_;
+  std::vector<const PostingCursor *> cursors_;
+};
\ No newline at end of file
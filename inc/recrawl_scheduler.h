@@ -0,0 +1,48 @@
+#pragma once
+#include "crawler_config.h"
+#include "database.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct RevisitPlan {
+  std::string url;
+  double change_rate = 0;
+  double change_probability = 0;
+  long long last_fetched = 0;
+  long long next_visit = 0;
+};
+
+// Orders a priority_queue of plans by next_visit, earliest on top.
+struct RevisitPlanLater {
+  bool operator()(const RevisitPlan &a, const RevisitPlan &b) const {
+    return a.next_visit > b.next_visit;
+  }
+};
+
+class RecrawlScheduler {
+public:
+  RecrawlScheduler(const CrawlerConfig &config, Database &db)
+      : config_(config), db_(db) {}
+
+  // Pages due at now, most likely changed first and within the daily
+  // budget. Pages not due yet go to upcoming when it is given.
+  std::vector<RevisitPlan> plan(long long now, size_t *deferred = nullptr,
+                                std::vector<RevisitPlan> *upcoming = nullptr);
+  // The next visit of a page fetched at fetched_at.
+  RevisitPlan next_plan(const std::string &url, double change_rate,
+                        long long fetched_at) const;
+  // Revisits the daily budget still allows at now.
+  size_t budget_left(long long now) const;
+
+  double estimate_change_rate(const PageHistorySummary &history) const;
+  double default_change_rate() const;
+  long long revisit_interval(double change_rate) const;
+  double change_probability(double change_rate, long long elapsed) const;
+
+  static uint64_t content_hash(const std::string &text);
+
+private:
+  const CrawlerConfig &config_;
+  Database &db_;
+};
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ArchiveRecord {
+  std::string url;
+  long long fetched_at = 0;
+  long http_status = 0;
+  std::string headers;
+  std::string body;
+};
+
+struct ArchiveIndexEntry {
+  std::string url;
+  long long fetched_at = 0;
+  long http_status = 0;
+  size_t offset = 0;
+  size_t length = 0;
+};
+
+class ResponseArchive {
+public:
+  ~ResponseArchive();
+
+  bool open(const std::string &dir, size_t segment_bytes, int level);
+  bool append(const ArchiveRecord &record);
+  void close();
+
+  static std::string serialize(const ArchiveRecord &record);
+  static bool deserialize(const std::string &data, ArchiveRecord &record);
+
+private:
+  bool open_segment();
+
+  std::string dir_;
+  size_t segment_bytes_ = 0;
+  int level_ = 3;
+
+  std::mutex mutex_;
+  FILE *data_ = nullptr;
+  FILE *index_ = nullptr;
+  size_t segment_ = 0;
+  size_t offset_ = 0;
+};
+
+class ArchiveSegment {
+public:
+  ArchiveSegment() = default;
+  ~ArchiveSegment();
+
+  bool open(const std::string &path);
+  const std::vector<ArchiveIndexEntry> &entries() const { return entries_; }
+  bool read(const ArchiveIndexEntry &entry, ArchiveRecord &record) const;
+
+  static std::vector<std::string> list(const std::string &dir);
+
+private:
+  ArchiveSegment(const ArchiveSegment &) = delete;
+  ArchiveSegment &operator=(const ArchiveSegment &) = delete;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<ArchiveIndexEntry> entries_;
+};
\ No newline at end of file
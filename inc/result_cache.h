@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Count-min sketch of recent access frequencies with 4-bit counters. All
+// counters are halved every sample_size increments, so old popularity
+// decays.
+class FrequencySketch {
+public:
+  explicit FrequencySketch(size_t expected_entries);
+
+  void increment(uint64_t hash);
+  uint32_t estimate(uint64_t hash) const;
+
+private:
+  static const size_t kDepth = 4;
+
+  size_t index(uint64_t hash, size_t row) const;
+  void halve();
+
+  std::vector<uint8_t> counters_;
+  size_t width_mask_;
+  size_t sample_size_;
+  size_t additions_ = 0;
+};
+
+// W-TinyLFU result cache bounded by an estimate of its memory use. New
+// entries land in a small LRU window; entries leaving the window only
+// enter the segmented-LRU main area if the sketch says they are requested
+// more often than the main area's eviction victim. Entries belong to one
+// index generation, and the whole cache is dropped when a newer one shows
+// up. Calls still on an older generation miss and store nothing.
+class ResultCache {
+public:
+  explicit ResultCache(size_t capacity_bytes);
+
+  bool get(const std::string &key, uint64_t generation,
+           std::vector<std::string> &results, double &cost_ms);
+  void put(const std::string &key, uint64_t generation,
+           const std::vector<std::string> &results, double cost_ms);
+
+  size_t size_bytes();
+  size_t entry_count();
+
+private:
+  enum Segment { WINDOW, PROBATION, PROTECTED };
+
+  struct Entry {
+    std::string key;
+    uint64_t hash;
+    std::vector<std::string> results;
+    double cost_ms;
+    size_t bytes;
+    Segment segment;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  EntryList &list(Segment segment);
+  size_t &bytes(Segment segment);
+  void move_to(EntryList::iterator entry, Segment segment);
+  void evict(EntryList::iterator entry);
+  void admit_from_window();
+  void reset(uint64_t generation);
+
+  std::mutex mutex_;
+  size_t capacity_bytes_;
+  size_t window_capacity_;
+  size_t protected_capacity_;
+  uint64_t generation_ = 0;
+  FrequencySketch sketch_;
+  EntryList window_;
+  EntryList probation_;
+  EntryList protected_;
+  size_t window_bytes_ = 0;
+  size_t probation_bytes_ = 0;
+  size_t protected_bytes_ = 0;
+  std::unordered_map<std::string, EntryList::iterator> entries_;
+};
\ No newline at end of file
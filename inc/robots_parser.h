@@ -13,6 +13,8 @@ public:
 
   int get_crawl_delay(const std::string &user_agent, const std::string &domain);
 
+  std::vector<std::string> get_sitemaps(const std::string &domain);
+
 private:
   struct RobotsData {
     std::vector<std::string> allow_rules;
@@ -26,6 +28,7 @@ private:
 
   std::unordered_map<std::string, std::unordered_map<std::string, RobotsData>>
       robots_cache;
+  std::unordered_map<std::string, std::vector<std::string>> sitemap_cache;
 
   std::mutex cache_mutex;
 };
\ No newline at end of file
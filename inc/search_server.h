@@ -0,0 +1,90 @@
+#pragma once
+#include "searcher.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Queries and replies are newline-delimited JSON objects:
+//
+//   {"id": 1, "query": "chocolate cake", "limit": 10, "any": false}
+//   {"id": 1, "results": ["https://..."], "took_ms": 0.08}
+//   {"id": 1, "error": "..."}
+//
+// "id" is echoed back unchanged, so pipelined requests on one connection can
+// be matched to replies that complete out of order. An address containing a
+// '/' (optionally prefixed with "unix:") names a Unix domain socket;
+// otherwise it is "[host:]port" with the host defaulting to 127.0.0.1.
+
+class SearchServer {
+public:
+  // Requests read from one connection but not yet answered, and reply bytes
+  // it has not taken yet; past either the server stops reading from it.
+  static const size_t kMaxInFlight = 64;
+  static const size_t kMaxPendingOutput = 1 << 20;
+
+  SearchServer(Searcher &searcher, size_t thread_count);
+  ~SearchServer();
+
+  bool listen(const std::string &address);
+  void run();
+  void stop();
+
+  static std::string handle(Searcher &searcher, const std::string &request);
+
+private:
+  // Sockets are non-blocking. Only the poll loop reads and owns input and
+  // read_closed; workers append replies to output under mutex, and the loop
+  // writes whatever the socket does not take at once.
+  struct Connection {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection();
+
+    bool flush();
+    bool has_room() const {
+      return in_flight < kMaxInFlight && output.size() < kMaxPendingOutput;
+    }
+
+    int fd;
+    std::string input;
+    bool read_closed = false;
+
+    std::mutex mutex;
+    std::string output;
+    size_t in_flight = 0;
+  };
+
+  struct QueryTask {
+    SearchServer *server;
+    std::shared_ptr<Connection> connection;
+    std::string request;
+  };
+
+  bool read_requests(Connection &connection);
+  void dispatch_requests(const std::shared_ptr<Connection> &connection);
+  static void run_query(void *arg);
+  void wake();
+
+  Searcher &searcher_;
+  parallel_scheduler *scheduler_;
+  int listen_fd_ = -1;
+  int wake_fds_[2] = {-1, -1};
+  std::string unix_path_;
+  std::atomic<bool> running_{false};
+};
+
+class SearchClient {
+public:
+  ~SearchClient();
+
+  bool connect(const std::string &address);
+  bool request(const std::string &line, std::string &reply);
+  bool search(const std::string &query, size_t limit, bool match_all,
+              std::vector<std::string> &results, std::string *error = nullptr);
+
+private:
+  int fd_ = -1;
+  std::string buffer_;
+  size_t next_id_ = 1;
+};
\ No newline at end of file
@@ -2,13 +2,37 @@
 
 #include "database.h"
 #include "includes.h"
+#include "inverted_index.h"
+#include "query_parser.h"
+#include "result_cache.h"
 
 class Searcher {
 public:
-  Searcher(char *db);
+  Searcher(char *db, size_t cache_bytes = kDefaultCacheBytes);
   ~Searcher();
-  std::vector<std::string> search(const std::string &query);
+  std::vector<std::string> search(const std::string &query,
+                                  size_t limit = kDefaultLimit,
+                                  bool match_all = true);
+
+  static constexpr size_t kDefaultLimit = 10;
+  static constexpr size_t kDefaultCacheBytes = 64 * 1024 * 1024;
 
 private:
+  uint64_t generation();
+  std::vector<std::string> search_index(const IndexQuery &query,
+                                        size_t limit);
+  std::vector<std::string> search_fts(const IndexQuery &query, size_t limit);
+  std::vector<std::string> search_like(const std::string &query,
+                                       size_t limit);
+  static bool fts_match(const IndexQuery &query, bool top_level,
+                        std::string &match, std::vector<std::string> &sites);
+
   Database db;
+  std::string index_dir_;
+  std::mutex index_mutex_;
+  std::shared_ptr<const InvertedIndex> index_;
+  uint64_t manifest_generation_ = 0;
+  bool has_index_ = false;
+  bool has_fts_ = false;
+  std::unique_ptr<ResultCache> cache_;
 };
\ No newline at end of file
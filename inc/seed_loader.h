@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class SeedLoader {
+public:
+  explicit SeedLoader(size_t thread_count);
+
+  bool load(const std::string &filename, std::vector<std::string> &urls);
+
+  size_t lines_read() const { return lines_read_; }
+
+private:
+  bool read_gzip(const char *data, size_t size, std::string &output);
+  void parse(const char *data, size_t size, std::vector<std::string> &urls);
+
+  size_t thread_count_;
+  size_t lines_read_ = 0;
+};
\ No newline at end of file
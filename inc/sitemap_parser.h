@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+struct SitemapEntry {
+  std::string loc;
+  long long lastmod = 0;
+  double priority = -1;
+  bool is_sitemap = false;
+};
+
+class SitemapParser {
+public:
+  using EntryCallback = std::function<void(const SitemapEntry &)>;
+
+  explicit SitemapParser(EntryCallback callback);
+  ~SitemapParser();
+
+  bool feed(const char *data, size_t size);
+  bool finish();
+
+  size_t entry_count() const { return entry_count_; }
+
+  static long long parse_lastmod(const std::string &value);
+
+private:
+  enum class Field { NONE, LOC, LASTMOD, PRIORITY };
+
+  bool inflate_chunk(const char *data, size_t size);
+  void scan(const char *data, size_t size);
+  void handle_markup();
+  void end_element(const std::string &name);
+  void start_element(const std::string &name);
+
+  struct Inflater;
+
+  EntryCallback callback_;
+  std::unique_ptr<Inflater> inflater_;
+  bool format_detected_ = false;
+  bool failed_ = false;
+
+  bool in_markup_ = false;
+  std::string markup_;
+  std::string text_;
+  Field field_ = Field::NONE;
+  bool in_entry_ = false;
+  SitemapEntry entry_;
+  size_t entry_count_ = 0;
+};
\ No newline at end of file
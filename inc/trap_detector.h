@@ -0,0 +1,22 @@
+#pragma once
+#include "crawler_config.h"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+class TrapDetector {
+public:
+  explicit TrapDetector(const CrawlerConfig &config) : config_(config) {}
+
+  bool admit(const std::string &url, std::string *reason = nullptr);
+
+  static std::string path_template(const std::string &url);
+
+private:
+  const CrawlerConfig &config_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, size_t> template_counts_;
+  std::unordered_map<std::string, std::unordered_set<size_t>> param_values_;
+};
\ No newline at end of file
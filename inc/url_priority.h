@@ -1,5 +1,6 @@
 #pragma once
 #include "crawler_config.h"
+#include "sitemap_parser.h"
 #include <functional>
 #include <string>
 
@@ -23,6 +24,9 @@ public:
   double calculate_priority(const std::string &url, int depth,
                             const std::string &content = "");
 
+  double calculate_sitemap_priority(const std::string &url,
+                                    const SitemapEntry &entry, long long now);
+
 private:
   const CrawlerConfig &config_;
 
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <regex>
 #include <string>
+#include <vector>
 
 class UrlUtils {
 public:
@@ -13,4 +14,11 @@ public:
   static bool is_same_domain(const std::string &url, const std::string &domain);
 
   static std::string extract_domain(const std::string &url);
+
+  static bool has_binary_extension(const std::string &url);
+
+  static void set_query_rules(const std::vector<std::string> &strip_params,
+                              bool sort_params);
+
+  static std::string canonicalize_query(const std::string &url);
 };
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "../../inc/response_archive.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+static const char *kSegmentPrefix = "segment-";
+static const char *kSegmentSuffix = ".warc.zst";
+static const char *kIndexSuffix = ".cdx";
+
+static std::string segment_path(const std::string &dir, size_t segment,
+                                const char *suffix) {
+  char name[32];
+  snprintf(name, sizeof(name), "%s%05zu%s", kSegmentPrefix, segment, suffix);
+  return (std::filesystem::path(dir) / name).string();
+}
+
+static bool is_segment(const std::string &name) {
+  size_t prefix = strlen(kSegmentPrefix);
+  size_t suffix = strlen(kSegmentSuffix);
+  return name.size() > prefix + suffix &&
+         name.compare(0, prefix, kSegmentPrefix) == 0 &&
+         name.compare(name.size() - suffix, suffix, kSegmentSuffix) == 0;
+}
+
+ResponseArchive::~ResponseArchive() { close(); }
+
+bool ResponseArchive::open(const std::string &dir, size_t segment_bytes,
+                           int level) {
+  std::error_code error;
+  std::filesystem::create_directories(dir, error);
+  if (error) {
+    std::cerr << "Failed to create archive directory " << dir << ": "
+              << error.message() << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  dir_ = dir;
+  segment_bytes_ = segment_bytes;
+  level_ = level;
+  segment_ = 0;
+  for (const auto &path : ArchiveSegment::list(dir)) {
+    std::string name = std::filesystem::path(path).filename().string();
+    segment_ = std::max<size_t>(
+        segment_, std::stoul(name.substr(strlen(kSegmentPrefix))) + 1);
+  }
+  return open_segment();
+}
+
+bool ResponseArchive::open_segment() {
+  data_ = fopen(segment_path(dir_, segment_, kSegmentSuffix).c_str(), "wb");
+  index_ = fopen(segment_path(dir_, segment_, kIndexSuffix).c_str(), "w");
+  offset_ = 0;
+  if (!data_ || !index_) {
+    std::cerr << "Failed to open archive segment " << segment_ << " in "
+              << dir_ << std::endl;
+    if (data_)
+      fclose(data_);
+    if (index_)
+      fclose(index_);
+    data_ = nullptr;
+    index_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void ResponseArchive::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (data_)
+    fclose(data_);
+  if (index_)
+    fclose(index_);
+  data_ = nullptr;
+  index_ = nullptr;
+}
+
+bool ResponseArchive::append(const ArchiveRecord &record) {
+  thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx *)> cctx(
+      ZSTD_createCCtx(), ZSTD_freeCCtx);
+
+  std::string raw = serialize(record);
+  std::string frame(ZSTD_compressBound(raw.size()), '\0');
+  size_t size = ZSTD_compressCCtx(cctx.get(), &frame[0], frame.size(),
+                                  raw.data(), raw.size(), level_);
+  if (ZSTD_isError(size))
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!data_)
+    return false;
+  if (offset_ > 0 && offset_ + size > segment_bytes_) {
+    fclose(data_);
+    fclose(index_);
+    ++segment_;
+    if (!open_segment())
+      return false;
+  }
+
+  if (fwrite(frame.data(), 1, size, data_) != size)
+    return false;
+  fprintf(index_, "%s %lld %ld %zu %zu\n", record.url.c_str(),
+          record.fetched_at, record.http_status, offset_, size);
+  offset_ += size;
+  return true;
+}
+
+static bool is_framing_header(const std::string &line) {
+  static const char *const names[] = {"content-encoding:",
+                                      "transfer-encoding:", "content-length:"};
+  for (const char *name : names) {
+    if (strncasecmp(line.c_str(), name, strlen(name)) == 0)
+      return true;
+  }
+  return false;
+}
+
+// The stored body is the one curl already decoded, so the wire's framing
+// headers are kept under X-Archive-Orig- names and Content-Length is set to
+// the stored size; WARC readers then take the body as it is.
+static std::string http_headers(const ArchiveRecord &record) {
+  std::string out;
+  if (record.headers.empty())
+    out = "HTTP/1.1 " + std::to_string(record.http_status) + "\r\n";
+
+  size_t start = 0;
+  while (start < record.headers.size()) {
+    size_t end = record.headers.find("\r\n", start);
+    if (end == std::string::npos)
+      end = record.headers.size();
+    std::string line = record.headers.substr(start, end - start);
+    start = end + 2;
+    if (line.empty())
+      continue;
+    if (is_framing_header(line))
+      out += "X-Archive-Orig-";
+    out += line + "\r\n";
+  }
+
+  out += "Content-Length: " + std::to_string(record.body.size()) + "\r\n";
+  return out;
+}
+
+std::string ResponseArchive::serialize(const ArchiveRecord &record) {
+  char date[32];
+  time_t fetched_at = static_cast<time_t>(record.fetched_at);
+  struct tm tm;
+  gmtime_r(&fetched_at, &tm);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+  std::string block = http_headers(record);
+  block += "\r\n";
+  block += record.body;
+
+  std::string out = "WARC/1.0\r\n"
+                    "WARC-Type: response\r\n"
+                    "WARC-Target-URI: " +
+                    record.url +
+                    "\r\n"
+                    "WARC-Date: " +
+                    date +
+                    "\r\n"
+                    "Content-Type: application/http; msgtype=response\r\n"
+                    "Content-Length: " +
+                    std::to_string(block.size()) + "\r\n\r\n";
+  out += block;
+  out += "\r\n\r\n";
+  return out;
+}
+
+bool ResponseArchive::deserialize(const std::string &data,
+                                  ArchiveRecord &record) {
+  size_t header_end = data.find("\r\n\r\n");
+  if (data.compare(0, 5, "WARC/") != 0 || header_end == std::string::npos)
+    return false;
+
+  size_t block_size = std::string::npos;
+  std::istringstream header(data.substr(0, header_end));
+  std::string line;
+  while (std::getline(header, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    size_t colon = line.find(": ");
+    if (colon == std::string::npos)
+      continue;
+    std::string name = line.substr(0, colon);
+    std::string value = line.substr(colon + 2);
+    if (name == "WARC-Target-URI") {
+      record.url = value;
+    } else if (name == "WARC-Date") {
+      struct tm tm = {};
+      if (strptime(value.c_str(), "%Y-%m-%dT%H:%M:%SZ", &tm))
+        record.fetched_at = static_cast<long long>(timegm(&tm));
+    } else if (name == "Content-Length") {
+      block_size = std::stoul(value);
+    }
+  }
+
+  size_t block_start = header_end + 4;
+  if (block_size == std::string::npos || block_start + block_size > data.size())
+    return false;
+
+  std::string block = data.substr(block_start, block_size);
+  size_t headers_end = block.find("\r\n\r\n");
+  if (headers_end == std::string::npos)
+    return false;
+
+  record.headers = block.substr(0, headers_end + 2);
+  record.body = block.substr(headers_end + 4);
+  size_t space = record.headers.find(' ');
+  record.http_status =
+      space == std::string::npos ? 0 : atol(record.headers.c_str() + space + 1);
+  return true;
+}
+
+ArchiveSegment::~ArchiveSegment() {
+  if (data_)
+    munmap(const_cast<char *>(data_), size_);
+}
+
+bool ArchiveSegment::open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Failed to open archive segment: " << path << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      ::close(fd);
+      std::cerr << "Failed to map archive segment: " << path << std::endl;
+      return false;
+    }
+    data_ = static_cast<const char *>(mapped);
+    madvise(mapped, size_, MADV_SEQUENTIAL);
+  }
+  ::close(fd);
+
+  std::string index_path =
+      path.substr(0, path.size() - strlen(kSegmentSuffix)) + kIndexSuffix;
+  std::ifstream index(index_path);
+  if (!index.is_open()) {
+    std::cerr << "Missing archive index: " << index_path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(index, line)) {
+    std::istringstream fields(line);
+    ArchiveIndexEntry entry;
+    if (!(fields >> entry.url >> entry.fetched_at >> entry.http_status >>
+          entry.offset >> entry.length))
+      continue;
+    if (entry.offset + entry.length > size_)
+      continue;
+    entries_.push_back(std::move(entry));
+  }
+  return true;
+}
+
+bool ArchiveSegment::read(const ArchiveIndexEntry &entry,
+                          ArchiveRecord &record) const {
+  thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx *)> dctx(
+      ZSTD_createDCtx(), ZSTD_freeDCtx);
+
+  const char *frame = data_ + entry.offset;
+  unsigned long long raw_size = ZSTD_getFrameContentSize(frame, entry.length);
+  if (raw_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+      raw_size == ZSTD_CONTENTSIZE_ERROR)
+    return false;
+
+  std::string raw(raw_size, '\0');
+  size_t size = ZSTD_decompressDCtx(dctx.get(), &raw[0], raw.size(), frame,
+                                    entry.length);
+  if (ZSTD_isError(size))
+    return false;
+  raw.resize(size);
+  return ResponseArchive::deserialize(raw, record);
+}
+
+std::vector<std::string> ArchiveSegment::list(const std::string &dir) {
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (const auto &entry : std::filesystem::directory_iterator(dir, error)) {
+    if (is_segment(entry.path().filename().string()))
+      paths.push_back(entry.path().string());
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
\ No newline at end of file
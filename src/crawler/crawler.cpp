@@ -1,4 +1,5 @@
 #include "../../inc/crawler.h"
+#include <deque>
 #include <thread>
 
 #define LOG(msg)                                                               \
@@ -6,14 +7,166 @@
     log_file << msg << std::endl;                                              \
   }
 
+struct WriteTarget {
+  CURL *curl;
+  std::string *content;
+  HtmlTokenizer *stream;
+  const CrawlerConfig *config;
+  size_t bytes = 0;
+  bool status_checked = false;
+  bool discard = false;
+  double parse_ms = 0;
+  std::string content_type{};
+  long long content_length = -1;
+  std::string abort_reason{};
+  std::string etag{};
+  std::string last_modified{};
+  std::string hop_url{};
+  std::string location{};
+  std::vector<std::string> redirects{};
+  std::string raw_headers{};
+};
+
+static std::string lowercase(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return value;
+}
+
+static bool accept_headers(WriteTarget *target) {
+  long code = 0;
+  curl_easy_getinfo(target->curl, CURLINFO_RESPONSE_CODE, &code);
+  if (code < 200 || code >= 300) {
+    return true;
+  }
+
+  if (!target->content_type.empty()) {
+    bool allowed = false;
+    for (const auto &prefix : target->config->allowed_content_types) {
+      if (target->content_type.compare(0, prefix.size(), prefix) == 0) {
+        allowed = true;
+        break;
+      }
+    }
+    if (!allowed) {
+      target->abort_reason = "content_type";
+      return false;
+    }
+  }
+
+  if (target->config->max_body_bytes > 0 &&
+      target->content_length >
+          static_cast<long long>(target->config->max_body_bytes)) {
+    target->abort_reason = "too_large";
+    return false;
+  }
+
+  return true;
+}
+
+static size_t HeaderCallback(char *buffer, size_t size, size_t nitems,
+                             WriteTarget *target) {
+  size_t totalSize = size * nitems;
+  std::string line(buffer, totalSize);
+  while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+    line.pop_back();
+  }
+
+  if (line.compare(0, 5, "HTTP/") == 0) {
+    target->content_type.clear();
+    target->content_length = -1;
+    target->etag.clear();
+    target->last_modified.clear();
+    target->location.clear();
+    target->raw_headers = line + "\r\n";
+    return totalSize;
+  }
+
+  if (line.empty()) {
+    long code = 0;
+    curl_easy_getinfo(target->curl, CURLINFO_RESPONSE_CODE, &code);
+    if (code >= 300 && code < 400 && !target->location.empty()) {
+      target->hop_url =
+          UrlUtils::make_absolute_url(target->hop_url, target->location);
+      target->redirects.push_back(target->hop_url);
+    }
+    return accept_headers(target) ? totalSize : 0;
+  }
+
+  size_t colon = line.find(':');
+  if (colon == std::string::npos) {
+    return totalSize;
+  }
+
+  std::string name = lowercase(line.substr(0, colon));
+  size_t value_start = line.find_first_not_of(" \t", colon + 1);
+  std::string value =
+      value_start == std::string::npos ? "" : line.substr(value_start);
+
+  if (name == "content-type") {
+    target->content_type = lowercase(value);
+  } else if (name == "content-length") {
+    try {
+      target->content_length = std::stoll(value);
+    } catch (...) {
+      target->content_length = -1;
+    }
+  } else if (name == "etag") {
+    target->etag = value;
+  } else if (name == "last-modified") {
+    target->last_modified = value;
+  } else if (name == "location") {
+    target->location = value;
+  }
+
+  target->raw_headers += line + "\r\n";
+  return totalSize;
+}
+
 static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
-                            std::string *output) {
+                            WriteTarget *target) {
   size_t totalSize = size * nmemb;
-  output->append((char *)contents, totalSize);
+  target->bytes += totalSize;
+
+  if (target->config->max_body_bytes > 0 &&
+      target->bytes > target->config->max_body_bytes) {
+    target->abort_reason = "too_large";
+    return 0;
+  }
+
+  if (!target->stream || !target->config->archive_dir.empty()) {
+    target->content->append((char *)contents, totalSize);
+  }
+  if (!target->stream) {
+    return totalSize;
+  }
+
+  if (!target->status_checked) {
+    long code = 0;
+    curl_easy_getinfo(target->curl, CURLINFO_RESPONSE_CODE, &code);
+    target->discard = code >= 400;
+    target->status_checked = true;
+    if (!target->redirects.empty()) {
+      target->stream->set_base_url(target->redirects.back());
+    }
+  }
+
+  if (!target->discard) {
+    auto start = std::chrono::steady_clock::now();
+    target->stream->feed(static_cast<const char *>(contents), totalSize);
+    target->parse_ms += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+  }
   return totalSize;
 }
 
-Crawler::Crawler(const CrawlerConfig &config) : config(config) {
+Crawler::Crawler(const CrawlerConfig &config)
+    : config(config), recrawl(this->config, db), trap_detector(this->config),
+      prioritizer(this->config) {
+
+  UrlUtils::set_query_rules(config.strip_query_params,
+                            config.sort_query_params);
 
   log_file.open(config.log_filename, std::ios::trunc);
 
@@ -25,24 +178,71 @@ Crawler::Crawler(const CrawlerConfig &config) : config(config) {
   }
   LOG("Parallel scheduler created successfully");
 
-  db.connect(config.db_name.c_str(), CRAWLER);
+  db.connect(config.db_name.c_str(),
+             config.incremental ? CRAWLER_INCREMENTAL : CRAWLER);
   db.create_table();
+  db.set_batching(config.db_batch_size, config.db_batch_ms);
+  db.set_cache_size(config.db_cache_kb);
+  db.set_compression(config.compress_content, config.zstd_level,
+                     config.zstd_dict_size, config.zstd_dict_training_samples);
+  db.set_fts_mode(Database::parse_fts_mode(config.fts_index));
+  db.start_writer(config.db_writer_queue_size);
+
+  if (!this->config.archive_dir.empty() &&
+      !archive.open(this->config.archive_dir,
+                    this->config.archive_segment_mb * 1024 * 1024,
+                    this->config.archive_level)) {
+    LOG("Failed to open response archive, archiving disabled");
+    this->config.archive_dir.clear();
+  }
   LOG("Database connected and table created.");
 
   user_agent = config.user_agent;
+  links_size = config.max_links;
+  parser.set_use_arena(config.gumbo_arena);
   MetricsCollector::instance().reset();
 }
 
 Crawler::~Crawler() {
+  if (exchange) {
+    exchange->stop();
+  }
   if (scheduler) {
     parallel_scheduler_destroy(scheduler);
   }
   scheduler = nullptr;
+  db.stop_writer();
+  archive.close();
   stop_metrics_reporting();
 }
 
+void Crawler::set_exchange(std::unique_ptr<PartitionExchange> partition) {
+  exchange = std::move(partition);
+  exchange->start(
+      [this](const std::string &url, int depth) { enqueue_remote(url, depth); },
+      [this]() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return waiting_for_links;
+      },
+      [this]() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue_cv.notify_all();
+      });
+  LOG("Partition " << config.partition_id << " of " << config.partition_count
+                   << " attached to URL exchange");
+}
+
 void Crawler::print_performance_report(std::ostream &os) {
-  MetricsCollector::instance().print_report(os);
+  MetricsCollector &metrics = MetricsCollector::instance();
+  metrics.print_report(os);
+
+  size_t stored = metrics.get_counter("content_bytes_stored");
+  if (stored > 0) {
+    os << "Content compression ratio: "
+       << static_cast<double>(metrics.get_counter("content_bytes_raw")) /
+              stored
+       << "\n";
+  }
 }
 
 void Crawler::reset_metrics() { MetricsCollector::instance().reset(); }
@@ -70,44 +270,178 @@ void Crawler::stop_metrics_reporting() {
   }
 }
 
+static std::string site_root(const std::string &url) {
+  size_t authority = url.find("://");
+  authority = authority == std::string::npos ? 0 : authority + 3;
+  return url.substr(0, url.find('/', authority));
+}
+
 void Crawler::load_links_from_file(const std::string &filename) {
   LOG("Loading links from file: " << filename);
-  std::ifstream file(filename);
-  if (!file.is_open()) {
-    LOG("Error: Unable to open file " << filename);
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::string> seeds;
+  SeedLoader loader(config.thread_count);
+  if (!loader.load(filename, seeds)) {
+    LOG("Error: Unable to read seed file " << filename);
     return;
   }
-  LOG("File opened successfully: " << filename);
-  std::string link;
-  while (std::getline(file, link)) {
-    if (!link.empty()) {
 
-      link = UrlUtils::normalize_url(link);
+  std::vector<UrlItem> items;
+  items.reserve(seeds.size());
+  url_depths.reserve(url_depths.size() + seeds.size());
+  size_t foreign = 0;
 
-      if (visited_links.find(link) == visited_links.end()) {
+  for (auto &link : seeds) {
+    if (visited_links.count(link) || url_depths.count(link)) {
+      continue;
+    }
 
-        add_to_queue(link, 0, 10.0);
-        main_links.insert(link);
+    std::string host = UrlUtils::extract_domain(link);
+    if (!host.empty() && seed_hosts.insert(host).second) {
+      for (size_t dot = host.find('.'); dot != std::string::npos;
+           dot = host.find('.', dot + 1)) {
+        seed_parent_domains.insert(host.substr(dot + 1));
+      }
+    }
+    if (exchange && !exchange->owns(link)) {
+      ++foreign;
+      continue;
+    }
 
-        std::string domain = UrlUtils::extract_domain(link);
-        LOG("Extracted domain from initial link: " << domain);
+    if (config.use_sitemaps) {
+      main_links.insert(site_root(link));
+    }
+    url_depths[link] = 0;
+    items.emplace_back(std::move(link), 0, 10.0);
+  }
 
-        url_depths[link] = 0;
-      } else {
-        LOG("URL already visited: " << link);
-      }
+  size_t queued = items.size();
+  if (link_queue.empty()) {
+    link_queue = std::priority_queue<UrlItem>(std::less<UrlItem>(),
+                                              std::move(items));
+  } else {
+    for (auto &item : items) {
+      link_queue.push(std::move(item));
     }
   }
 
-  LOG("Loaded main domains:");
-  for (const auto &link : main_links) {
-    LOG(" - " << UrlUtils::extract_domain(link));
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  MetricsCollector::instance().record_metric("seed_load", elapsed_ms);
+  LOG("Loaded " << queued << " seeds from " << loader.lines_read()
+                << " lines (" << seeds.size() << " unique, " << foreign
+                << " owned by other partitions) in " << elapsed_ms << " ms");
+
+  if (config.incremental) {
+    load_known_pages();
   }
 }
 
-void Crawler::add_to_queue(const std::string &url, int depth, double priority) {
+void Crawler::load_known_pages() {
+  size_t deferred = 0;
+  size_t loaded = 0;
+  std::vector<RevisitPlan> upcoming;
+
+  for (const auto &plan :
+       recrawl.plan(static_cast<long long>(std::time(nullptr)), &deferred,
+                    &upcoming)) {
+    if (url_depths.count(plan.url) ||
+        (exchange && !exchange->owns(plan.url))) {
+      continue;
+    }
+    LOG("Revisiting " << plan.url << " (change rate " << plan.change_rate
+                      << "/s, change probability "
+                      << plan.change_probability << ")");
+    add_to_queue(plan.url, 1, 1.0 + 9.0 * plan.change_probability);
+    revisit_rates[plan.url] = plan.change_rate;
+    ++loaded;
+  }
+
+  for (const auto &plan : upcoming) {
+    if (!exchange || exchange->owns(plan.url)) {
+      schedule_revisit(plan);
+    }
+  }
+
+  MetricsCollector::instance().increment_counter("recrawl_pages_due", loaded);
+  MetricsCollector::instance().increment_counter("recrawl_pages_deferred",
+                                                 deferred);
+  LOG("Queued " << loaded << " previously crawled pages for revalidation, "
+                << deferred << " deferred, " << revisits.size()
+                << " scheduled for later");
+}
+
+void Crawler::schedule_revisit(const RevisitPlan &plan) {
+  revisit_rates[plan.url] = plan.change_rate;
+  next_revisit[plan.url] = plan.next_visit;
+  revisits.push(plan);
+}
+
+void Crawler::reschedule_revisit(const std::string &url,
+                                 long long fetched_at) {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  auto rate = revisit_rates.find(url);
+  schedule_revisit(recrawl.next_plan(url,
+                                     rate != revisit_rates.end()
+                                         ? rate->second
+                                         : recrawl.default_change_rate(),
+                                     fetched_at));
+}
+
+// Moves revisits that have come due onto the queue. Entries replaced by a
+// later fetch of the same page are skipped. Called with queue_mutex held
+// and only while the queue has other work, so a run still ends once its
+// frontier is exhausted; revisits due after that wait for the next run.
+void Crawler::queue_due_revisits(long long now) {
+  size_t budget = 0;
+  bool budget_checked = false;
+  size_t queued = 0;
+  size_t deferred = 0;
+
+  while (!revisits.empty() && revisits.top().next_visit <= now) {
+    RevisitPlan plan = revisits.top();
+    revisits.pop();
+
+    auto next = next_revisit.find(plan.url);
+    if (next == next_revisit.end() || next->second != plan.next_visit) {
+      continue;
+    }
+    next_revisit.erase(next);
 
-  static UrlPrioritizer prioritizer(config);
+    if (!budget_checked) {
+      budget = recrawl.budget_left(now);
+      budget = budget > revisit_links.size() ? budget - revisit_links.size()
+                                             : 0;
+      budget_checked = true;
+    }
+    if (budget == 0) {
+      ++deferred;
+      continue;
+    }
+    --budget;
+
+    double probability =
+        recrawl.change_probability(plan.change_rate, now - plan.last_fetched);
+    LOG("Revisit due for " << plan.url << " (change probability "
+                           << probability << ")");
+    revisit_links.insert(plan.url);
+    add_to_queue(plan.url, 1, 1.0 + 9.0 * probability);
+    ++queued;
+  }
+
+  if (queued > 0) {
+    MetricsCollector::instance().increment_counter("recrawl_pages_due",
+                                                   queued);
+  }
+  if (deferred > 0) {
+    MetricsCollector::instance().increment_counter("recrawl_pages_deferred",
+                                                   deferred);
+  }
+}
+
+void Crawler::add_to_queue(const std::string &url, int depth, double priority) {
 
   if (priority == 0.0) {
     priority = prioritizer.calculate_priority(url, depth);
@@ -119,6 +453,58 @@ void Crawler::add_to_queue(const std::string &url, int depth, double priority) {
   LOG("Added URL with priority " << priority << ": " << url);
 }
 
+void Crawler::enqueue_remote(const std::string &url, int depth) {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+
+  if (visited_links.size() >= links_size || link_queue.size() >= links_size ||
+      url_depths.count(url) || fetched_links.count(url)) {
+    return;
+  }
+
+  LOG("Received link from partition exchange (depth " << depth
+                                                      << "): " << url);
+  add_to_queue(url, depth);
+  waiting_for_links = false;
+  queue_cv.notify_one();
+}
+
+bool Crawler::mark_fetched(const std::string &url,
+                           const std::string &storage_url,
+                           const PageFetchInfo &info, int depth) {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+
+  if (storage_url != url && fetched_links.count(storage_url)) {
+    return false;
+  }
+
+  fetched_links.insert(url);
+  fetched_links.insert(storage_url);
+  url_depths.emplace(storage_url, depth);
+  for (const auto &hop : info.redirect_chain) {
+    fetched_links.insert(hop);
+    url_depths.emplace(hop, depth);
+  }
+  return true;
+}
+
+bool Crawler::wait_for_remote_links(std::unique_lock<std::mutex> &lock) {
+  if (!exchange) {
+    return false;
+  }
+
+  lock.unlock();
+  exchange->flush();
+  lock.lock();
+
+  LOG("Queue empty, waiting for links from other partitions");
+  waiting_for_links = true;
+  queue_cv.wait(lock, [this]() {
+    return !waiting_for_links || exchange->finished();
+  });
+  waiting_for_links = false;
+  return !link_queue.empty();
+}
+
 static bool is_valid_domain(const std::string &link,
                             const std::string &main_url) {
   try {
@@ -178,7 +564,7 @@ void Crawler::run(size_t size) {
     process_links(size);
 
     {
-      std::lock_guard<std::mutex> lock(queue_mutex);
+      std::unique_lock<std::mutex> lock(queue_mutex);
       LOG("Queue status: " << link_queue.size() << " links in queue, "
                            << visited_links.size() << " visited links out of "
                            << size << " maximum");
@@ -191,28 +577,51 @@ void Crawler::run(size_t size) {
           task_cv.wait(lock, [this]() { return active_tasks == 0; });
         }
 
+        // Past the budget enqueue_remote refuses links, so this waits for
+        // the other partitions to finish rather than for work.
+        wait_for_remote_links(lock);
+
         LOG("Processing remaining links...");
         break;
       }
 
       if (link_queue.empty()) {
+        if (wait_for_remote_links(lock)) {
+          continue;
+        }
         LOG("No more links to process. Exiting...");
         break;
       }
     }
   }
 
+  if (exchange) {
+    exchange->stop();
+    MetricsCollector::instance().increment_counter("partition_urls_sent",
+                                                   exchange->sent_count());
+    MetricsCollector::instance().increment_counter(
+        "partition_urls_received", exchange->received_count());
+    MetricsCollector::instance().increment_counter("partition_urls_dropped",
+                                                   exchange->dropped_count());
+  }
+
+  db.flush();
+  if (Database::parse_fts_mode(config.fts_index) == FtsMode::BULK) {
+    std::cout << "Building full-text index..." << std::endl;
+    db.build_fts();
+  }
+
   std::cout << "\nCrawling completed." << std::endl;
   std::cout << "Processed " << visited_links.size() << " URLs." << std::endl;
   std::cout << "Results saved to " << config.db_name << std::endl;
 
-  std::ofstream report("performance_report.txt");
+  std::ofstream report(config.report_filename);
   if (report.is_open()) {
     report << "\n===== Final Performance Report =====" << std::endl;
     print_performance_report(report);
     report << "==========================================\n";
-    std::cout << "Performance report saved to 'performance_report.txt'"
-              << std::endl;
+    std::cout << "Performance report saved to '" << config.report_filename
+              << "'" << std::endl;
   }
 }
 
@@ -248,6 +657,232 @@ bool Crawler::url_matches_keywords(const std::string &url) {
   return false;
 }
 
+struct SitemapTarget {
+  SitemapParser *parser;
+  const bool *stop;
+  size_t bytes = 0;
+};
+
+static size_t SitemapWriteCallback(void *contents, size_t size, size_t nmemb,
+                                   SitemapTarget *target) {
+  size_t totalSize = size * nmemb;
+  target->bytes += totalSize;
+  if (*target->stop ||
+      !target->parser->feed(static_cast<const char *>(contents), totalSize)) {
+    return 0;
+  }
+  return totalSize;
+}
+
+// Reads the sitemaps of a seed's site the first time a URL of that site is
+// crawled, on the worker that crawled it, so startup never waits on
+// robots.txt. All sites share the sitemap_max_files budget.
+void Crawler::discover_sitemaps(const std::string &url) {
+  std::string root = site_root(url);
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!main_links.erase(root) ||
+        sitemap_files >= config.sitemap_max_files) {
+      return;
+    }
+  }
+
+  std::deque<std::string> pending;
+  for (auto &sitemap :
+       robots_parser.get_sitemaps(UrlUtils::extract_domain(url))) {
+    pending.push_back(std::move(sitemap));
+  }
+  if (pending.empty()) {
+    pending.push_back(root + "/sitemap.xml");
+  }
+
+  long long now = static_cast<long long>(std::time(nullptr));
+  size_t files = 0;
+  size_t queued = 0;
+
+  while (!pending.empty()) {
+    std::string sitemap_url = pending.front();
+    pending.pop_front();
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      if (sitemap_files >= config.sitemap_max_files) {
+        break;
+      }
+      if (!sitemaps_seen.insert(sitemap_url).second) {
+        continue;
+      }
+      ++sitemap_files;
+    }
+
+    bool stop = false;
+    SitemapParser parser([&](const SitemapEntry &entry) {
+      if (entry.is_sitemap) {
+        pending.push_back(entry.loc);
+      } else if (enqueue_sitemap_entry(entry, now)) {
+        ++queued;
+      } else {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stop = link_queue.size() >= links_size;
+      }
+    });
+
+    ++files;
+    if (!fetch_sitemap(sitemap_url, parser, stop) && !stop) {
+      LOG("Failed to read sitemap: " << sitemap_url);
+      continue;
+    }
+
+    LOG("Read sitemap " << sitemap_url << ": " << parser.entry_count()
+                        << " entries");
+    MetricsCollector::instance().increment_counter("sitemap_entries_read",
+                                                   parser.entry_count());
+    if (stop) {
+      LOG("Frontier full, not reading further sitemaps");
+      break;
+    }
+  }
+
+  MetricsCollector::instance().increment_counter("sitemap_files_fetched",
+                                                 files);
+  MetricsCollector::instance().increment_counter("sitemap_urls_queued", queued);
+}
+
+bool Crawler::fetch_sitemap(const std::string &url, SitemapParser &parser,
+                            const bool &stop) {
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    LOG("Error: Failed to initialize CURL for sitemap: " << url);
+    return false;
+  }
+
+  SitemapTarget target{&parser, &stop};
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, SitemapWriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &target);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent.c_str());
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT,
+                   static_cast<long>(config.request_timeout_sec));
+
+  CURLcode res = curl_easy_perform(curl);
+
+  curl_off_t wire_bytes = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+  curl_easy_cleanup(curl);
+  MetricsCollector::instance().add_bytes_downloaded(
+      wire_bytes, target.bytes, UrlUtils::extract_domain(url));
+
+  if (res != CURLE_OK) {
+    LOG("Error fetching sitemap " << url << ": " << curl_easy_strerror(res));
+    return false;
+  }
+  return parser.finish();
+}
+
+bool Crawler::enqueue_sitemap_entry(const SitemapEntry &entry, long long now) {
+  std::string link = UrlUtils::normalize_url(entry.loc);
+
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  if (link_queue.size() >= links_size) {
+    return false;
+  }
+
+  if (!in_seed_domains(link) || UrlUtils::has_binary_extension(link) ||
+      url_depths.count(link) || fetched_links.count(link) ||
+      (exchange && !exchange->owns(link)) || !url_matches_keywords(link) ||
+      !admit_link(link)) {
+    return false;
+  }
+
+  add_to_queue(link, 1,
+               prioritizer.calculate_sitemap_priority(link, entry, now));
+  return true;
+}
+
+// Same rule as is_valid_domain against every seed: the link's host is a
+// seed host, a subdomain of one, or a parent domain of one. Called with
+// queue_mutex held.
+bool Crawler::in_seed_domains(const std::string &link) const {
+  std::string host = UrlUtils::extract_domain(link);
+  if (host.empty()) {
+    return false;
+  }
+  if (seed_parent_domains.count(host)) {
+    return true;
+  }
+  for (size_t start = 0; start != std::string::npos;) {
+    if (seed_hosts.count(host.substr(start))) {
+      return true;
+    }
+    start = host.find('.', start);
+    start = start == std::string::npos ? start : start + 1;
+  }
+  return false;
+}
+
+bool Crawler::admit_link(const std::string &link) {
+  std::string reason;
+  if (trap_detector.admit(link, &reason)) {
+    return true;
+  }
+
+  LOG("Dropping likely crawler trap (" << reason << "): " << link);
+  MetricsCollector::instance().increment_counter("trap_dropped_" + reason);
+  return false;
+}
+
+void Crawler::enqueue_links(const std::vector<std::string> &links, int depth) {
+  std::vector<std::string> foreign_links;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    LOG("Adding links to queue. Current link count: " << links.size());
+
+    if (visited_links.size() < links_size) {
+      for (const auto &link : links) {
+        bool valid_domain = in_seed_domains(link);
+
+        if (valid_domain && UrlUtils::has_binary_extension(link)) {
+          LOG("Skipping URL with binary extension: " << link);
+          MetricsCollector::instance().increment_counter(
+              "links_skipped_binary_extension");
+          continue;
+        }
+
+        if (valid_domain && exchange && !exchange->owns(link)) {
+          if (url_matches_keywords(link) && !forwarded_links.count(link) &&
+              admit_link(link)) {
+            forwarded_links.insert(link);
+            foreign_links.push_back(link);
+          }
+          continue;
+        }
+
+        if (valid_domain && !url_depths.count(link) &&
+            !fetched_links.count(link)) {
+
+          if (url_matches_keywords(link) && link_queue.size() < links_size) {
+            if (admit_link(link)) {
+              LOG("Adding link to queue (depth " << depth << "): " << link);
+              add_to_queue(link, depth);
+            }
+          } else {
+            LOG("Skipping URL due to keyword filter: " << link);
+          }
+        }
+      }
+    }
+  }
+
+  for (const auto &link : foreign_links) {
+    LOG("Forwarding link to partition "
+        << PartitionExchange::partition_for(link, config.partition_count)
+        << " (depth " << depth << "): " << link);
+    exchange->send(link, depth);
+  }
+}
+
 void Crawler::process(const std::string &current_link, int depth) {
 
   {
@@ -305,41 +940,93 @@ void Crawler::process(const std::string &current_link, int depth) {
   }
 
   std::string content;
-  std::unordered_set<std::string> links;
-  std::string text;
+  ParsedPage page;
+  bool fetch_success;
 
-  bool fetch_success = fetch_page_with_retry(current_link, content);
-
-  if (fetch_success) {
-    parse_page(content, links, text, 1, current_link);
-    save_to_database(current_link, text);
-
-    {
-      std::lock_guard<std::mutex> lock(queue_mutex);
-      LOG("Adding links to queue. Current link count: " << links.size());
+  PageFetchInfo fetch_info;
+  PageFetchInfo previous;
+  if (config.incremental && db.get_fetch_info(current_link, previous)) {
+    fetch_info = previous;
+  }
 
-      if (visited_links.size() < links_size) {
-        for (const auto &link : links) {
-          bool valid_domain = false;
+  if (config.streaming_parse) {
+    HtmlTokenizer stream(page, current_link);
+    fetch_success = fetch_page_with_retry(current_link, content, 0, 0,
+                                          &stream, &fetch_info);
+    if (fetch_success && fetch_info.http_status != 304) {
+      stream.finish();
+      LOG("Streamed page: " << page.links.size() << " links, text length "
+                            << page.text.size());
+    }
+  } else {
+    fetch_success = fetch_page_with_retry(current_link, content, 0, 0,
+                                          nullptr, &fetch_info);
+    if (fetch_success && fetch_info.http_status != 304) {
+      fetch_info.parse_ms = parse_page(content, page,
+                                       fetch_info.effective_url.empty()
+                                           ? current_link
+                                           : fetch_info.effective_url);
+    }
+  }
 
-          for (const auto &main_link : main_links) {
-            if (is_valid_domain(link, main_link)) {
-              valid_domain = true;
-              break;
-            }
-          }
+  std::string storage_url = current_link;
+  bool duplicate = false;
+  if (fetch_success && fetch_info.http_status != 304) {
+    std::string final_url = fetch_info.effective_url.empty()
+                                ? current_link
+                                : fetch_info.effective_url;
+    storage_url = final_url;
+
+    if (!page.canonical.empty()) {
+      std::string canonical = UrlUtils::normalize_url(page.canonical);
+      if (canonical != final_url && is_valid_domain(canonical, final_url)) {
+        LOG("Page declares canonical URL " << canonical << ": "
+                                           << current_link);
+        storage_url = canonical;
+      }
+    }
 
-          if (valid_domain && visited_links.find(link) == visited_links.end()) {
+    duplicate = !mark_fetched(current_link, storage_url, fetch_info, depth);
+  }
 
-            if (url_matches_keywords(link) && link_queue.size() < links_size) {
-              LOG("Adding link to queue (depth " << depth + 1 << "): " << link);
-              add_to_queue(link, depth + 1);
-            } else {
-              LOG("Skipping URL due to keyword filter: " << link);
-            }
-          }
-        }
-      }
+  if (duplicate) {
+    LOG("Already fetched as " << storage_url << ", skipping: "
+                              << current_link);
+    MetricsCollector::instance().increment_counter("duplicate_pages_skipped");
+  } else if (fetch_success && fetch_info.http_status == 304) {
+    LOG("Page not modified since " << previous.fetched_at << ": "
+                                   << current_link);
+    db.mark_not_modified(current_link, fetch_info);
+    db.record_fetch(current_link, fetch_info.fetched_at, 0, true);
+    reschedule_revisit(current_link, fetch_info.fetched_at);
+    MetricsCollector::instance().increment_counter("not_modified_responses");
+    MetricsCollector::instance().increment_counter("not_modified_bytes_saved",
+                                                   previous.body_bytes);
+    MetricsCollector::instance().record_metric(
+        "not_modified_parse_saved", previous.parse_ms, true,
+        UrlUtils::extract_domain(current_link));
+  } else if (fetch_success) {
+    if (!config.archive_dir.empty()) {
+      archive_response(current_link, content, fetch_info);
+    }
+    if (page.noindex) {
+      LOG("Page requests noindex, not saving: " << current_link);
+    } else {
+      save_to_database(storage_url, page.text, fetch_info);
+    }
+    if (config.incremental) {
+      db.record_fetch(storage_url, fetch_info.fetched_at,
+                      RecrawlScheduler::content_hash(page.text), false);
+      reschedule_revisit(storage_url, fetch_info.fetched_at);
+    }
+    // Streamed links are held in page.links until here as well, so that
+    // failed attempts and duplicates queue nothing.
+    if (page.nofollow) {
+      LOG("Page requests nofollow, ignoring its links: " << current_link);
+    } else {
+      enqueue_links(
+          std::vector<std::string>(page.links.begin(), page.links.end()),
+          depth + 1);
     }
   } else {
     LOG("Failed to fetch page: " << current_link
@@ -396,14 +1083,15 @@ void Crawler::process_remaining_links() {
     }
 
     std::string content;
-    std::unordered_set<std::string> links;
-    std::string text;
+    ParsedPage page;
 
     bool fetch_success = fetch_page_with_retry(current_link, content);
 
     if (fetch_success) {
-      parse_page(content, links, text, 0, current_link);
-      save_to_database(current_link, text);
+      parse_page(content, page, current_link);
+      if (!page.noindex) {
+        save_to_database(current_link, page.text);
+      }
     } else {
       LOG("Failed to fetch remaining page: " << current_link);
     }
@@ -436,12 +1124,25 @@ void Crawler::process_links(size_t size) {
       if (link_queue.empty() || visited_links.size() >= size) {
         break;
       }
+      if (config.incremental) {
+        queue_due_revisits(static_cast<long long>(std::time(nullptr)));
+      }
 
       UrlItem item = link_queue.top();
       link_queue.pop();
       current_link = item.url;
       depth = item.depth;
 
+      if (revisit_links.erase(current_link)) {
+        fetched_links.erase(current_link);
+      } else if (visited_links.count(current_link) ||
+                 fetched_links.count(current_link)) {
+        LOG("Skipping already fetched URL: " << current_link);
+        MetricsCollector::instance().increment_counter(
+            "queued_links_already_fetched");
+        continue;
+      }
+
       LOG("Processing URL with priority " << item.priority << " and depth "
                                           << depth << ": " << current_link);
     }
@@ -465,6 +1166,9 @@ void Crawler::process_links(size_t size) {
           int depth = std::get<2>(*task_data);
 
           crawler->process(link, depth);
+          if (crawler->config.use_sitemaps) {
+            crawler->discover_sitemaps(link);
+          }
 
           {
             std::lock_guard<std::mutex> lock(crawler->task_mutex);
@@ -486,41 +1190,62 @@ bool Crawler::fetch_page(const std::string &url, std::string &content) {
   return fetch_page_with_http_code(url, content, &http_code);
 }
 
-void Crawler::parse_page(const std::string &content,
-                         std::unordered_set<std::string> &links,
-                         std::string &text, int mode,
-                         const std::string &base_url) {
+double Crawler::parse_page(const std::string &content, ParsedPage &page,
+                           const std::string &base_url) {
 
   if (content.empty()) {
-    links.clear();
-    text.clear();
-    return;
+    page = ParsedPage();
+    return 0;
   }
-  if (mode) {
-    links = parser.extract_links(content, base_url);
+  auto start = std::chrono::steady_clock::now();
+  page = parser.parse(content, base_url);
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  MetricsCollector::instance().record_metric(
+      "html_parse", elapsed_ms, true, UrlUtils::extract_domain(base_url));
+
+  LOG("Extracted links count: " << page.links.size());
+  LOG("Extracted text length: " << page.text.size());
+  LOG("Extracted title: " << page.title);
+  return elapsed_ms;
+}
+
+void Crawler::archive_response(const std::string &url,
+                               const std::string &content,
+                               const PageFetchInfo &info) {
+  ArchiveRecord record;
+  record.url = info.effective_url.empty() ? url : info.effective_url;
+  record.fetched_at = info.fetched_at;
+  record.http_status = info.http_status;
+  record.headers = info.headers;
+  record.body = content;
+
+  if (archive.append(record)) {
+    MetricsCollector::instance().increment_counter("archive_records");
+    MetricsCollector::instance().increment_counter("archive_body_bytes",
+                                                   content.size());
+  } else {
+    MetricsCollector::instance().increment_counter("archive_write_failures");
   }
-  text = parser.extract_text(content);
-  LOG("Extracted links count: " << links.size());
-  LOG("Extracted text length: " << text.size());
 }
 
-void Crawler::save_to_database(const std::string &url,
-                               const std::string &text) {
+void Crawler::save_to_database(const std::string &url, const std::string &text,
+                               const PageFetchInfo &info) {
 
   LOG("Saving to database URL: " << url
                                  << " with text length: " << text.size());
-  LOG("Database state: Checking if URL is processed: " << url);
-  if (!db.is_url_processed(url)) {
-    LOG("Database state: URL not processed, inserting page.");
-    db.insert_page(url, text);
-  } else {
-    LOG("Database state: URL already processed.");
-  }
+  if (config.incremental)
+    db.upsert_page(url, text, info);
+  else
+    db.insert_page(url, text, info);
 }
 
 bool Crawler::fetch_page_with_retry(const std::string &url,
                                     std::string &content, int max_retries,
-                                    int retry_delay_sec) {
+                                    int retry_delay_sec,
+                                    HtmlTokenizer *stream,
+                                    PageFetchInfo *info) {
 
   if (max_retries <= 0)
     max_retries = config.max_retries;
@@ -528,7 +1253,15 @@ bool Crawler::fetch_page_with_retry(const std::string &url,
     retry_delay_sec = config.retry_delay_sec;
 
   long http_code = 0;
-  bool success = fetch_page_with_http_code(url, content, &http_code);
+  std::string abort_reason;
+  bool success = fetch_page_with_http_code(url, content, &http_code, stream,
+                                           info, &abort_reason);
+
+  if (!abort_reason.empty()) {
+    LOG("Download aborted (" << abort_reason << ") for URL: " << url
+                             << " - not retrying");
+    return false;
+  }
 
   if (http_code >= 400 && http_code < 500) {
     LOG("Client error " << http_code << " for URL: " << url
@@ -542,10 +1275,17 @@ bool Crawler::fetch_page_with_retry(const std::string &url,
                            << " for URL: " << url);
       std::this_thread::sleep_for(std::chrono::seconds(retry_delay_sec));
 
-      if (fetch_page_with_http_code(url, content, &http_code)) {
+      if (fetch_page_with_http_code(url, content, &http_code, stream, info,
+                                    &abort_reason)) {
         return true;
       }
 
+      if (!abort_reason.empty()) {
+        LOG("Download aborted (" << abort_reason << ") on retry for URL: "
+                                 << url);
+        return false;
+      }
+
       if (http_code >= 400 && http_code < 500) {
         LOG("Client error " << http_code << " on retry for URL: " << url);
         return false;
@@ -557,23 +1297,84 @@ bool Crawler::fetch_page_with_retry(const std::string &url,
 }
 
 bool Crawler::fetch_page_with_http_code(const std::string &url,
-                                        std::string &content, long *http_code) {
+                                        std::string &content, long *http_code,
+                                        HtmlTokenizer *stream,
+                                        PageFetchInfo *info,
+                                        std::string *abort_reason) {
   content.clear();
+  if (stream) {
+    stream->reset();
+  }
+
   CURL *curl = curl_easy_init();
   if (!curl) {
     LOG("Error: Failed to initialize CURL for URL: " << url);
     return false;
   }
 
+  WriteTarget target{curl, &content, stream, &config};
+  target.hop_url = url;
+
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &content);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &target);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &target);
   curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent.c_str());
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
   curl_easy_setopt(curl, CURLOPT_TIMEOUT,
                    static_cast<long>(config.request_timeout_sec));
+  if (config.compressed_transfer) {
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  }
+
+  struct curl_slist *headers = nullptr;
+  if (info && !info->etag.empty()) {
+    headers =
+        curl_slist_append(headers, ("If-None-Match: " + info->etag).c_str());
+  }
+  if (info && !info->last_modified.empty()) {
+    headers = curl_slist_append(
+        headers, ("If-Modified-Since: " + info->last_modified).c_str());
+  }
+  if (headers) {
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  }
 
   CURLcode res = curl_easy_perform(curl);
+  curl_slist_free_all(headers);
+
+  curl_off_t wire_bytes = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+  std::string domain = UrlUtils::extract_domain(url);
+
+  if (!target.abort_reason.empty()) {
+    if (http_code) {
+      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, http_code);
+    }
+    curl_easy_cleanup(curl);
+
+    // Content-Length counts the body as sent, before any decoding.
+    size_t saved = target.content_length > static_cast<long long>(wire_bytes)
+                       ? target.content_length - wire_bytes
+                       : 0;
+    MetricsCollector::instance().increment_counter("downloads_aborted_" +
+                                                   target.abort_reason);
+    MetricsCollector::instance().increment_counter("download_bytes_saved",
+                                                   saved);
+    MetricsCollector::instance().add_bytes_downloaded(wire_bytes, target.bytes,
+                                                      domain);
+
+    LOG("Aborted download (" << target.abort_reason << ", content type '"
+                             << target.content_type << "', "
+                             << target.bytes << " bytes received) for URL: "
+                             << url);
+
+    if (abort_reason) {
+      *abort_reason = target.abort_reason;
+    }
+    return false;
+  }
 
   if (res != CURLE_OK) {
     LOG("Error: curl_easy_perform() failed for URL: "
@@ -594,13 +1395,46 @@ bool Crawler::fetch_page_with_http_code(const std::string &url,
   LOG("HTTP response code for URL " << url << ": "
                                     << (http_code ? *http_code : 0));
 
+  if (info && http_code) {
+    info->effective_url.clear();
+    info->redirect_chain.clear();
+    for (const auto &hop : target.redirects) {
+      info->redirect_chain.push_back(UrlUtils::normalize_url(hop));
+    }
+    if (!info->redirect_chain.empty()) {
+      info->effective_url = info->redirect_chain.back();
+      MetricsCollector::instance().increment_counter(
+          "redirects_followed", info->redirect_chain.size());
+    }
+
+    info->http_status = *http_code;
+    info->fetched_at = static_cast<long long>(std::time(nullptr));
+    if (*http_code == 304) {
+      if (!target.etag.empty())
+        info->etag = target.etag;
+      if (!target.last_modified.empty())
+        info->last_modified = target.last_modified;
+      return true;
+    }
+    info->etag = target.etag;
+    info->last_modified = target.last_modified;
+    info->headers = target.raw_headers;
+    info->body_bytes = target.bytes;
+    info->parse_ms = target.parse_ms;
+  }
+
   if (http_code && (*http_code >= 200 && *http_code < 400)) {
-    if (content.empty()) {
+    if (target.bytes == 0) {
       LOG("Warning: Empty content with successful HTTP code for URL: " << url);
       return false;
     }
 
-    MetricsCollector::instance().add_bytes_downloaded(content.size());
+    MetricsCollector::instance().add_bytes_downloaded(wire_bytes, target.bytes,
+                                                      domain);
+    if (stream) {
+      MetricsCollector::instance().record_metric("html_parse", target.parse_ms,
+                                                 true, domain);
+    }
     return true;
   }
 
@@ -31,9 +31,121 @@ CrawlerConfig CrawlerConfig::load_from_file(const std::string &filename) {
     if (j.contains("request_timeout_sec"))
       config.request_timeout_sec = j["request_timeout_sec"];
 
+    if (j.contains("db_batch_size"))
+      config.db_batch_size = j["db_batch_size"];
+
+    if (j.contains("db_batch_ms"))
+      config.db_batch_ms = j["db_batch_ms"];
+
+    if (j.contains("db_writer_queue_size"))
+      config.db_writer_queue_size = j["db_writer_queue_size"];
+
+    if (j.contains("db_cache_kb"))
+      config.db_cache_kb = j["db_cache_kb"];
+
+    if (j.contains("compress_content"))
+      config.compress_content = j["compress_content"];
+
+    if (j.contains("zstd_level"))
+      config.zstd_level = j["zstd_level"];
+
+    if (j.contains("zstd_dict_size"))
+      config.zstd_dict_size = j["zstd_dict_size"];
+
+    if (j.contains("zstd_dict_training_samples"))
+      config.zstd_dict_training_samples = j["zstd_dict_training_samples"];
+
+    if (j.contains("fts_index"))
+      config.fts_index = j["fts_index"];
+
+    if (j.contains("archive_dir"))
+      config.archive_dir = j["archive_dir"];
+
+    if (j.contains("archive_segment_mb"))
+      config.archive_segment_mb = j["archive_segment_mb"];
+
+    if (j.contains("archive_level"))
+      config.archive_level = j["archive_level"];
+
     if (j.contains("max_links"))
       config.max_links = j["max_links"];
 
+    if (j.contains("incremental"))
+      config.incremental = j["incremental"];
+
+    if (j.contains("recrawl_daily_budget"))
+      config.recrawl_daily_budget = j["recrawl_daily_budget"];
+
+    if (j.contains("recrawl_default_interval_hours"))
+      config.recrawl_default_interval_hours =
+          j["recrawl_default_interval_hours"];
+
+    if (j.contains("recrawl_min_interval_hours"))
+      config.recrawl_min_interval_hours = j["recrawl_min_interval_hours"];
+
+    if (j.contains("recrawl_max_interval_hours"))
+      config.recrawl_max_interval_hours = j["recrawl_max_interval_hours"];
+
+    if (j.contains("recrawl_target_change_probability"))
+      config.recrawl_target_change_probability =
+          j["recrawl_target_change_probability"];
+
+    if (j.contains("use_sitemaps"))
+      config.use_sitemaps = j["use_sitemaps"];
+
+    if (j.contains("sitemap_max_files"))
+      config.sitemap_max_files = j["sitemap_max_files"];
+
+    if (j.contains("sitemap_priority_weight"))
+      config.sitemap_priority_weight = j["sitemap_priority_weight"];
+
+    if (j.contains("sitemap_freshness_weight"))
+      config.sitemap_freshness_weight = j["sitemap_freshness_weight"];
+
+    if (j.contains("compressed_transfer"))
+      config.compressed_transfer = j["compressed_transfer"];
+
+    if (j.contains("max_body_bytes"))
+      config.max_body_bytes = j["max_body_bytes"];
+
+    if (j.contains("allowed_content_types") &&
+        j["allowed_content_types"].is_array()) {
+      config.allowed_content_types.clear();
+      for (const auto &type : j["allowed_content_types"]) {
+        if (type.is_string()) {
+          config.allowed_content_types.push_back(type.get<std::string>());
+        }
+      }
+    }
+
+    if (j.contains("strip_query_params") &&
+        j["strip_query_params"].is_array()) {
+      config.strip_query_params.clear();
+      for (const auto &param : j["strip_query_params"]) {
+        if (param.is_string()) {
+          config.strip_query_params.push_back(param.get<std::string>());
+        }
+      }
+    }
+
+    if (j.contains("sort_query_params"))
+      config.sort_query_params = j["sort_query_params"];
+
+    if (j.contains("trap_max_url_length"))
+      config.trap_max_url_length = j["trap_max_url_length"];
+
+    if (j.contains("trap_max_path_depth"))
+      config.trap_max_path_depth = j["trap_max_path_depth"];
+
+    if (j.contains("trap_max_repeated_segments"))
+      config.trap_max_repeated_segments = j["trap_max_repeated_segments"];
+
+    if (j.contains("trap_max_urls_per_template"))
+      config.trap_max_urls_per_template = j["trap_max_urls_per_template"];
+
+    if (j.contains("trap_max_param_values"))
+      config.trap_max_param_values = j["trap_max_param_values"];
+
     if (j.contains("max_retries"))
       config.max_retries = j["max_retries"];
 
@@ -43,6 +155,9 @@ CrawlerConfig CrawlerConfig::load_from_file(const std::string &filename) {
     if (j.contains("log_filename"))
       config.log_filename = j["log_filename"];
 
+    if (j.contains("report_filename"))
+      config.report_filename = j["report_filename"];
+
     if (j.contains("verbose_logging"))
       config.verbose_logging = j["verbose_logging"];
 
@@ -67,6 +182,18 @@ CrawlerConfig CrawlerConfig::load_from_file(const std::string &filename) {
     if (j.contains("cross_domain_keyword_weight"))
       config.cross_domain_keyword_weight = j["cross_domain_keyword_weight"];
 
+    if (j.contains("gumbo_arena"))
+      config.gumbo_arena = j["gumbo_arena"];
+
+    if (j.contains("streaming_parse"))
+      config.streaming_parse = j["streaming_parse"];
+
+    if (j.contains("partition_count"))
+      config.partition_count = j["partition_count"];
+
+    if (j.contains("partition_batch_size"))
+      config.partition_batch_size = j["partition_batch_size"];
+
   } catch (const std::exception &e) {
     std::cerr << "Error loading config: " << e.what() << std::endl;
   }
@@ -1,64 +1,242 @@
 #include "../../inc/htmlparser.h"
+#include "../../inc/url_utils.h"
+#include <cstdlib>
 #include <cstring>
 #include <gumbo.h>
+#include <new>
+#include <sstream>
+#include <strings.h>
+#include <vector>
 
-static void find_links(GumboNode *node,
-                       std::unordered_set<std::string> &links) {
-  if (node->type != GUMBO_NODE_ELEMENT) {
-    return;
+HTMLParser::HTMLParser() {}
+HTMLParser::~HTMLParser() {}
+
+// Bump allocator for Gumbo parse trees. Nothing is freed individually; the
+// whole tree is released by reset() once the page has been walked.
+class GumboArena {
+public:
+  ~GumboArena() {
+    for (auto &block : blocks_)
+      std::free(block.data);
   }
 
-  GumboElement *element = &node->v.element;
+  void *allocate(size_t size) {
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
 
-  if (element->tag == GUMBO_TAG_A) {
-    GumboAttribute *href = gumbo_get_attribute(&element->attributes, "href");
-    if (href && href->value && std::strlen(href->value) > 0) {
-      links.insert(href->value);
+    while (current_ < blocks_.size()) {
+      Block &block = blocks_[current_];
+      if (block.used + size <= block.size) {
+        void *ptr = block.data + block.used;
+        block.used += size;
+        return ptr;
+      }
+      ++current_;
     }
+
+    size_t block_size = std::max(kBlockSize, size);
+    char *data = static_cast<char *>(std::malloc(block_size));
+    if (!data)
+      throw std::bad_alloc();
+
+    blocks_.push_back({data, block_size, size});
+    current_ = blocks_.size() - 1;
+    return data;
   }
 
-  for (unsigned int i = 0; i < element->children.length; ++i) {
-    find_links(static_cast<GumboNode *>(element->children.data[i]), links);
+  void reset() {
+    size_t retained = 0;
+    size_t kept = 0;
+    for (auto &block : blocks_) {
+      if (retained + block.size <= kRetainedBytes) {
+        retained += block.size;
+        block.used = 0;
+        blocks_[kept++] = block;
+      } else {
+        std::free(block.data);
+      }
+    }
+    blocks_.resize(kept);
+    current_ = 0;
+  }
+
+private:
+  struct Block {
+    char *data;
+    size_t size;
+    size_t used;
+  };
+
+  static constexpr size_t kAlignment = 16;
+  static constexpr size_t kBlockSize = 256 * 1024;
+  static constexpr size_t kRetainedBytes = 8 * 1024 * 1024;
+
+  std::vector<Block> blocks_;
+  size_t current_ = 0;
+};
+
+static void *arena_allocate(void *userdata, size_t size) {
+  return static_cast<GumboArena *>(userdata)->allocate(size);
+}
+
+static void arena_deallocate(void *, void *) {}
+
+static GumboArena &thread_arena() {
+  thread_local GumboArena arena;
+  return arena;
+}
+
+struct PageWalk {
+  ParsedPage &page;
+  std::vector<const char *> hrefs;
+  const char *base_href = nullptr;
+  const char *canonical_href = nullptr;
+  bool in_head_title = false;
+};
+
+static bool is_followable_href(const char *href) {
+  return href && *href && *href != '#' &&
+         std::strncmp(href, "javascript:", 11) != 0 &&
+         std::strncmp(href, "mailto:", 7) != 0;
+}
+
+static bool is_canonical_rel(const char *rel) {
+  std::string tokens = rel;
+  std::transform(tokens.begin(), tokens.end(), tokens.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  std::istringstream stream(tokens);
+  std::string token;
+  while (stream >> token) {
+    if (token == "canonical")
+      return true;
   }
+  return false;
 }
 
-static void find_text(GumboNode *node, std::string &text) {
+static void walk_node(GumboNode *node, PageWalk &walk) {
   if (node->type == GUMBO_NODE_TEXT) {
-    text += node->v.text.text;
-    text += " ";
-  } else if (node->type == GUMBO_NODE_ELEMENT) {
-    GumboElement *element = &node->v.element;
-    if (element->tag == GUMBO_TAG_SCRIPT || element->tag == GUMBO_TAG_STYLE) {
-      return;
+    if (walk.in_head_title && walk.page.title.empty()) {
+      walk.page.title = node->v.text.text;
+    }
+    walk.page.text += node->v.text.text;
+    walk.page.text += " ";
+    return;
+  }
+
+  if (node->type != GUMBO_NODE_ELEMENT) {
+    return;
+  }
+
+  GumboElement *element = &node->v.element;
+
+  switch (element->tag) {
+  case GUMBO_TAG_SCRIPT:
+  case GUMBO_TAG_STYLE:
+    return;
+  case GUMBO_TAG_A: {
+    GumboAttribute *href = gumbo_get_attribute(&element->attributes, "href");
+    if (href && is_followable_href(href->value)) {
+      walk.hrefs.push_back(href->value);
     }
-    for (unsigned int i = 0; i < element->children.length; ++i) {
-      find_text(static_cast<GumboNode *>(element->children.data[i]), text);
+    break;
+  }
+  case GUMBO_TAG_BASE: {
+    GumboAttribute *href = gumbo_get_attribute(&element->attributes, "href");
+    if (href && href->value && *href->value && !walk.base_href) {
+      walk.base_href = href->value;
     }
+    break;
+  }
+  case GUMBO_TAG_LINK: {
+    GumboAttribute *rel = gumbo_get_attribute(&element->attributes, "rel");
+    GumboAttribute *href = gumbo_get_attribute(&element->attributes, "href");
+    if (rel && href && href->value && *href->value && !walk.canonical_href &&
+        is_canonical_rel(rel->value)) {
+      walk.canonical_href = href->value;
+    }
+    break;
+  }
+  case GUMBO_TAG_META: {
+    GumboAttribute *name = gumbo_get_attribute(&element->attributes, "name");
+    GumboAttribute *content =
+        gumbo_get_attribute(&element->attributes, "content");
+    if (name && content && strcasecmp(name->value, "robots") == 0) {
+      walk.page.apply_robots_directives(content->value);
+    }
+    break;
+  }
+  default:
+    break;
   }
+
+  bool was_title = walk.in_head_title;
+  walk.in_head_title = element->tag == GUMBO_TAG_TITLE;
+
+  for (unsigned int i = 0; i < element->children.length; ++i) {
+    walk_node(static_cast<GumboNode *>(element->children.data[i]), walk);
+  }
+
+  walk.in_head_title = was_title;
 }
 
-std::unordered_set<std::string>
-HTMLParser::extract_links(const std::string &html) {
+ParsedPage HTMLParser::parse(const std::string &html,
+                             const std::string &base_url) {
+  ParsedPage page;
   if (html.empty())
-    return {};
-  GumboOutput *gumbo = gumbo_parse(html.c_str());
-  std::unordered_set<std::string> links;
+    return page;
+
+  GumboOptions options = kGumboDefaultOptions;
+  if (use_arena_) {
+    options.allocator = arena_allocate;
+    options.deallocator = arena_deallocate;
+    options.userdata = &thread_arena();
+  }
+
+  GumboOutput *gumbo =
+      gumbo_parse_with_options(&options, html.data(), html.size());
 
-  find_links(gumbo->root, links);
+  PageWalk walk{page, {}, nullptr, nullptr, false};
+  walk_node(gumbo->root, walk);
 
-  gumbo_destroy_output(&kGumboDefaultOptions, gumbo);
+  std::string base = base_url;
+  if (walk.base_href) {
+    base = base_url.empty() ? std::string(walk.base_href)
+                            : UrlUtils::make_absolute_url(base_url,
+                                                          walk.base_href);
+  }
+
+  if (walk.canonical_href) {
+    page.canonical =
+        base.empty() ? std::string(walk.canonical_href)
+                     : UrlUtils::make_absolute_url(base, walk.canonical_href);
+  }
+
+  page.links.reserve(walk.hrefs.size());
+  for (const char *href : walk.hrefs) {
+    page.links.insert(base.empty() ? std::string(href)
+                                   : UrlUtils::make_absolute_url(base, href));
+  }
+
+  if (use_arena_) {
+    thread_arena().reset();
+  } else {
+    gumbo_destroy_output(&options, gumbo);
+  }
 
-  return links;
+  return page;
 }
-std::string HTMLParser::extract_text(const std::string &html) {
-  if (html.empty())
-    return {};
-  GumboOutput *gumbo = gumbo_parse(html.c_str());
-  std::string text;
 
-  find_text(gumbo->root, text);
+std::unordered_set<std::string>
+HTMLParser::extract_links(const std::string &html) {
+  return extract_links(html, "");
+}
 
-  gumbo_destroy_output(&kGumboDefaultOptions, gumbo);
+std::unordered_set<std::string>
+HTMLParser::extract_links(const std::string &html,
+                          const std::string &base_url) {
+  return parse(html, base_url).links;
+}
 
-  return text;
+std::string HTMLParser::extract_text(const std::string &html) {
+  return parse(html, "").text;
 }
\ No newline at end of file
@@ -1,37 +1,171 @@
 #include "../../inc/crawler.h"
 #include "../../inc/crawler_config.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <sys/wait.h>
 
 CrawlerConfig config;
 
-int main(int argc, char *argv[]) {
-  try {
+static std::string partition_filename(const std::string &filename,
+                                      size_t partition) {
+  std::string suffix = ".part" + std::to_string(partition);
+  size_t dot = filename.find_last_of('.');
+  size_t slash = filename.find_last_of('/');
+  if (dot == std::string::npos ||
+      (slash != std::string::npos && dot < slash)) {
+    return filename + suffix;
+  }
+  return filename.substr(0, dot) + suffix + filename.substr(dot);
+}
 
-    if (argc > 1) {
-      config = CrawlerConfig::load_from_file(argv[1]);
+static int run_crawler(const CrawlerConfig &config,
+                       const std::string &links_file,
+                       std::unique_ptr<PartitionExchange> exchange = nullptr) {
+  Crawler crawler(config);
+
+  if (exchange) {
+    crawler.set_exchange(std::move(exchange));
+  }
+
+  crawler.load_links_from_file(links_file);
+  crawler.run(config.max_links);
+
+  std::cout << "\n===== Final Performance Report =====\n";
+  crawler.print_performance_report(std::cout);
+
+  std::ofstream report_file(config.report_filename);
+  if (report_file.is_open()) {
+    crawler.print_performance_report(report_file);
+    std::cout << "Performance report saved to '" << config.report_filename
+              << "'\n";
+  }
+
+  return 0;
+}
+
+static int run_partitioned(const CrawlerConfig &config,
+                           const std::string &links_file) {
+  size_t count = config.partition_count;
+  std::string group = "search_engine." + std::to_string(getpid());
+
+  std::vector<int> fds = PartitionExchange::bind_sockets(group, count);
+  PartitionCoordinator coordinator(group, count);
+  if (fds.size() != count || !coordinator.bind()) {
+    std::cerr << "Error: failed to set up partition sockets" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Starting " << count << " crawler partitions" << std::endl;
+
+  std::vector<pid_t> children;
+  for (size_t i = 0; i < count; ++i) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "Error: fork failed for partition " << i << std::endl;
+      break;
     }
 
-    Crawler crawler(config);
+    if (pid == 0) {
+      for (size_t j = 0; j < count; ++j) {
+        if (j != i)
+          close(fds[j]);
+      }
+
+      CrawlerConfig partition_config = config;
+      partition_config.partition_id = i;
+      partition_config.max_links = (config.max_links + count - 1) / count;
+      partition_config.db_name = partition_filename(config.db_name, i);
+      partition_config.log_filename =
+          partition_filename(config.log_filename, i);
+      partition_config.report_filename =
+          partition_filename(config.report_filename, i);
+      if (!config.archive_dir.empty())
+        partition_config.archive_dir =
+            partition_filename(config.archive_dir, i);
 
-    if (argc > 2) {
-      crawler.load_links_from_file(argv[2]);
-    } else {
-      crawler.load_links_from_file("links.txt");
+      int status = 1;
+      try {
+        status = run_crawler(partition_config, links_file,
+                             std::make_unique<PartitionExchange>(
+                                 group, i, count, fds[i],
+                                 config.partition_batch_size));
+      } catch (const std::exception &e) {
+        std::cerr << "Partition " << i << " error: " << e.what() << std::endl;
+      }
+      std::cout.flush();
+      _exit(status);
     }
 
-    crawler.run(config.max_links);
+    children.push_back(pid);
+  }
+
+  for (int fd : fds)
+    close(fd);
+
+  // Partitions run until the coordinator sees the whole crawl idle. One
+  // that exits earlier has failed, and its links could never be delivered,
+  // so the others are stopped too.
+  int result = children.size() == count ? 0 : 1;
+  bool finished = result != 0;
+  if (finished)
+    coordinator.finish();
+
+  size_t running = children.size();
+  while (running > 0) {
+    if (!finished && coordinator.poll(100)) {
+      coordinator.finish();
+      finished = true;
+    }
+
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, finished ? 0 : WNOHANG);
+    if (pid <= 0)
+      continue;
+    size_t i = std::find(children.begin(), children.end(), pid) -
+               children.begin();
+    if (i == children.size())
+      continue;
+    running--;
+
+    if (WIFSIGNALED(status)) {
+      std::cerr << "Partition " << i << " terminated by signal "
+                << WTERMSIG(status) << std::endl;
+      result = 1;
+    } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cerr << "Partition " << i << " exited with an error" << std::endl;
+      result = 1;
+    }
+    if (!finished) {
+      std::cerr << "Partition " << i
+                << " exited before the crawl finished, stopping the others"
+                << std::endl;
+      coordinator.finish();
+      finished = true;
+      result = 1;
+    }
+  }
+
+  std::cout << "All partitions finished. Database shards: "
+            << partition_filename(config.db_name, 0) << " .. "
+            << partition_filename(config.db_name, count - 1) << std::endl;
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  try {
+
+    if (argc > 1) {
+      config = CrawlerConfig::load_from_file(argv[1]);
+    }
 
-    std::cout << "\n===== Final Performance Report =====\n";
-    crawler.print_performance_report(std::cout);
+    std::string links_file = argc > 2 ? argv[2] : "links.txt";
 
-    std::ofstream report_file("performance_report.txt");
-    if (report_file.is_open()) {
-      crawler.print_performance_report(report_file);
-      std::cout << "Performance report saved to 'performance_report.txt'\n";
+    if (config.partition_count > 1) {
+      return run_partitioned(config, links_file);
     }
 
-    return 0;
+    return run_crawler(config, links_file);
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << std::endl;
     return 1;
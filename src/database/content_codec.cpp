@@ -0,0 +1,176 @@
+#include "../../inc/content_codec.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <zdict.h>
+
+static const size_t kMaxSampleBytes = 64 * 1024;
+static const size_t kMaxTotalSampleBytes = 64 * 1024 * 1024;
+// Less sample text than this trains nothing useful, and a few bytes can
+// crash ZDICT.
+static const size_t kMinTrainingBytes = 4096;
+
+ContentCodec::~ContentCodec() {
+  for (auto &domain : domains_)
+    ZSTD_freeCDict(domain.second.cdict);
+  for (auto &ddict : ddicts_)
+    ZSTD_freeDDict(ddict.second);
+}
+
+void ContentCodec::configure(int level, size_t dict_size,
+                             size_t training_samples) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  level_ = level;
+  dict_size_ = dict_size;
+  training_samples_ = training_samples;
+}
+
+bool ContentCodec::compress(const std::string &domain, const std::string &text,
+                            std::string &out, long long &dict_id,
+                            ZstdDictionary *trained) {
+  thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx *)> cctx(
+      ZSTD_createCCtx(), ZSTD_freeCCtx);
+
+  ZSTD_CDict *cdict = nullptr;
+  std::vector<std::string> samples;
+  dict_id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DomainState &state = domains_[domain];
+    if (state.cdict) {
+      cdict = state.cdict;
+      dict_id = state.dict_id;
+    } else if (trained && !state.training && training_samples_ > 0 &&
+               dict_size_ > 0) {
+      if (!state.sampling) {
+        state.lru = sampling_.insert(sampling_.begin(), domain);
+        state.sampling = true;
+      } else {
+        sampling_.splice(sampling_.begin(), sampling_, state.lru);
+      }
+      state.samples.push_back(text.substr(0, kMaxSampleBytes));
+      state.sample_bytes += state.samples.back().size();
+      sample_bytes_ += state.samples.back().size();
+
+      if (state.samples.size() >= training_samples_) {
+        state.training = true;
+        samples.swap(state.samples);
+        drop_samples(state);
+      }
+      while (sample_bytes_ > kMaxTotalSampleBytes && !sampling_.empty()) {
+        auto cold = domains_.find(sampling_.back());
+        drop_samples(cold->second);
+        if (!cold->second.cdict && !cold->second.training)
+          domains_.erase(cold);
+      }
+    }
+  }
+
+  if (!samples.empty() && !train(domain, std::move(samples), *trained)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    domains_[domain].training = false;
+  }
+
+  out.resize(ZSTD_compressBound(text.size()));
+  size_t size =
+      cdict ? ZSTD_compress_usingCDict(cctx.get(), &out[0], out.size(),
+                                       text.data(), text.size(), cdict)
+            : ZSTD_compressCCtx(cctx.get(), &out[0], out.size(), text.data(),
+                                text.size(), level_);
+  if (ZSTD_isError(size)) {
+    std::cerr << "zstd compression failed: " << ZSTD_getErrorName(size)
+              << std::endl;
+    out.clear();
+    return false;
+  }
+  out.resize(size);
+  return true;
+}
+
+// Called with mutex_ held.
+void ContentCodec::drop_samples(DomainState &state) {
+  if (!state.sampling)
+    return;
+  state.sampling = false;
+  sampling_.erase(state.lru);
+  sample_bytes_ -= state.sample_bytes;
+  state.sample_bytes = 0;
+  state.samples.clear();
+}
+
+bool ContentCodec::train(const std::string &domain,
+                         std::vector<std::string> samples,
+                         ZstdDictionary &dictionary) {
+  std::string buffer;
+  std::vector<size_t> sizes;
+  for (const auto &sample : samples) {
+    buffer += sample;
+    sizes.push_back(sample.size());
+  }
+  if (buffer.size() < kMinTrainingBytes)
+    return false;
+
+  std::string data(dict_size_, '\0');
+  size_t size = ZDICT_trainFromBuffer(&data[0], data.size(), buffer.data(),
+                                      sizes.data(), sizes.size());
+  if (ZDICT_isError(size))
+    return false;
+  data.resize(size);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  dictionary.id = next_dict_id_++;
+  dictionary.domain = domain;
+  dictionary.data = std::move(data);
+  return true;
+}
+
+void ContentCodec::add_dictionary(const ZstdDictionary &dictionary) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (ddicts_.count(dictionary.id))
+    return;
+
+  ddicts_[dictionary.id] =
+      ZSTD_createDDict(dictionary.data.data(), dictionary.data.size());
+  next_dict_id_ = std::max(next_dict_id_, dictionary.id + 1);
+
+  DomainState &state = domains_[dictionary.domain];
+  if (state.dict_id < dictionary.id) {
+    ZSTD_freeCDict(state.cdict);
+    state.cdict = ZSTD_createCDict(dictionary.data.data(),
+                                   dictionary.data.size(), level_);
+    state.dict_id = dictionary.id;
+    state.training = true;
+  }
+}
+
+bool ContentCodec::decompress(const void *data, size_t size, long long dict_id,
+                              std::string &out) {
+  thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx *)> dctx(
+      ZSTD_createDCtx(), ZSTD_freeDCtx);
+
+  unsigned long long content_size = ZSTD_getFrameContentSize(data, size);
+  if (content_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+      content_size == ZSTD_CONTENTSIZE_ERROR)
+    return false;
+
+  ZSTD_DDict *ddict = nullptr;
+  if (dict_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ddicts_.find(dict_id);
+    if (it == ddicts_.end())
+      return false;
+    ddict = it->second;
+  }
+
+  out.resize(content_size);
+  size_t written =
+      ddict ? ZSTD_decompress_usingDDict(dctx.get(), &out[0], out.size(), data,
+                                         size, ddict)
+            : ZSTD_decompressDCtx(dctx.get(), &out[0], out.size(), data, size);
+  if (ZSTD_isError(written)) {
+    out.clear();
+    return false;
+  }
+  out.resize(written);
+  return true;
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "../../inc/database.h"
+#include "../../inc/metrics_collector.h"
 #include "../../inc/url_utils.h"
 
 StmtGuard::StmtGuard(sqlite3_stmt *stmt) : stmt_(stmt) {}
@@ -13,15 +14,150 @@ sqlite3_stmt *StmtGuard::get() { return stmt_; }
 
 StmtGuard::operator sqlite3_stmt *() { return stmt_; }
 
+CachedStmt::CachedStmt(sqlite3_stmt *stmt) : stmt_(stmt) {}
+
+CachedStmt::~CachedStmt() {
+  if (stmt_) {
+    sqlite3_reset(stmt_);
+    sqlite3_clear_bindings(stmt_);
+  }
+}
+
+CachedStmt::operator sqlite3_stmt *() { return stmt_; }
+
+static void bind_fetch_info(sqlite3_stmt *stmt, int first,
+                            const PageFetchInfo &info) {
+  sqlite3_bind_text(stmt, first, info.etag.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, first + 1, info.last_modified.c_str(), -1,
+                    SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, first + 2, info.http_status);
+  sqlite3_bind_int64(stmt, first + 3, info.fetched_at);
+  sqlite3_bind_int64(stmt, first + 4,
+                     static_cast<sqlite3_int64>(info.body_bytes));
+  sqlite3_bind_double(stmt, first + 5, info.parse_ms);
+}
+
 void Database::connect(const std::string &db_name, int mode) {
-  if (mode == CRAWLER)
-    std::filesystem::remove(db_name.c_str());
-  if (sqlite3_open(db_name.c_str(), &db) != SQLITE_OK) {
+  // A fresh crawl must not inherit a WAL or journal left by a killed run,
+  // which SQLite would replay into the new file.
+  if (mode == CRAWLER) {
+    for (const char *suffix : {"", "-wal", "-shm", "-journal"})
+      std::filesystem::remove(db_name + suffix);
+  }
+  int flags = mode == SEARCHER ? SQLITE_OPEN_READONLY
+                               : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+  if (sqlite3_open_v2(db_name.c_str(), &db, flags, nullptr) != SQLITE_OK) {
     std::cerr << "SQLite3 connection error: " << sqlite3_errmsg(db) << "\n";
     sqlite3_close(db);
     db = nullptr;
+    return;
+  }
+  sqlite3_busy_timeout(db, 5000);
+  register_functions();
+  if (mode == SEARCHER) {
+    refresh_dictionaries(data_version());
+    return;
+  }
+
+  char *err_msg = nullptr;
+  if (sqlite3_exec(db,
+                   "PRAGMA journal_mode = WAL;"
+                   "PRAGMA synchronous = NORMAL;"
+                   "PRAGMA temp_store = MEMORY;",
+                   nullptr, 0, &err_msg) != SQLITE_OK) {
+    std::cerr << "SQL error: " << err_msg << "\n";
+    sqlite3_free(err_msg);
+  }
+}
+
+void Database::set_cache_size(size_t cache_kb) {
+  if (!db)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string sql = "PRAGMA cache_size = -" + std::to_string(cache_kb) + ";";
+  char *err_msg = nullptr;
+  if (sqlite3_exec(db, sql.c_str(), nullptr, 0, &err_msg) != SQLITE_OK) {
+    std::cerr << "SQL error: " << err_msg << "\n";
+    sqlite3_free(err_msg);
+  }
+}
+
+void Database::set_compression(bool enabled, int level, size_t dict_size,
+                               size_t training_samples) {
+  compress_ = enabled;
+  codec_.configure(level, dict_size, training_samples);
+}
+
+void Database::register_functions() {
+  sqlite3_create_function(db, "page_text", 3,
+                          SQLITE_UTF8 | SQLITE_DETERMINISTIC, this,
+                          &Database::page_text_function, nullptr, nullptr);
+  sqlite3_create_function(db, "url_site", 2,
+                          SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                          &Database::url_site_function, nullptr, nullptr);
+}
+
+// url_site(url, host) is 1 when url is on host or one of its subdomains.
+void Database::url_site_function(sqlite3_context *context, int,
+                                 sqlite3_value **argv) {
+  const unsigned char *url = sqlite3_value_text(argv[0]);
+  const unsigned char *host = sqlite3_value_text(argv[1]);
+  bool match = url && host &&
+               UrlUtils::is_same_domain(reinterpret_cast<const char *>(url),
+                                        reinterpret_cast<const char *>(host));
+  sqlite3_result_int(context, match);
+}
+
+void Database::page_text_function(sqlite3_context *context, int,
+                                  sqlite3_value **argv) {
+  if (sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+    sqlite3_result_value(context, argv[0]);
+    return;
+  }
+
+  Database *self = static_cast<Database *>(sqlite3_user_data(context));
+  std::string text;
+  if (!self->decompress_content(sqlite3_value_blob(argv[1]),
+                                sqlite3_value_bytes(argv[1]),
+                                sqlite3_value_int64(argv[2]), text)) {
+    sqlite3_result_error(context, "failed to decompress page content", -1);
+    return;
+  }
+  sqlite3_result_text(context, text.data(), text.size(), SQLITE_TRANSIENT);
+}
+
+// Readers that stay open, like searcher --serve, call this with the
+// current data_version to pick up dictionaries trained since they started.
+void Database::refresh_dictionaries(long long version) {
+  if (!db)
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (version == dictionaries_version_)
+    return;
+  load_dictionaries();
+  dictionaries_version_ = version;
+}
+
+void Database::load_dictionaries() {
+  sqlite3_stmt *raw_stmt;
+  if (sqlite3_prepare_v2(db, "SELECT id, domain, data FROM dictionaries;", -1,
+                         &raw_stmt, nullptr) != SQLITE_OK)
+    return;
+
+  StmtGuard stmt(raw_stmt);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    ZstdDictionary dictionary;
+    dictionary.id = sqlite3_column_int64(stmt, 0);
+    dictionary.domain =
+        reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
+    dictionary.data.assign(
+        static_cast<const char *>(sqlite3_column_blob(stmt, 2)),
+        sqlite3_column_bytes(stmt, 2));
+    codec_.add_dictionary(dictionary);
   }
 }
+
 void Database::create_table() {
   if (!db) {
     std::cerr << "Database is not connected." << std::endl;
@@ -31,11 +167,280 @@ void Database::create_table() {
   std::string sql = "CREATE TABLE IF NOT EXISTS pages ("
                     "id INTEGER PRIMARY KEY AUTOINCREMENT,"
                     "url TEXT UNIQUE,"
-                    "content TEXT );";
+                    "content TEXT,"
+                    "etag TEXT,"
+                    "last_modified TEXT,"
+                    "http_status INTEGER,"
+                    "fetched_at INTEGER,"
+                    "body_bytes INTEGER,"
+                    "parse_ms REAL,"
+                    "content_zstd BLOB,"
+                    "dict_id INTEGER );";
+  if (sqlite3_exec(db, sql.c_str(), nullptr, 0, &err_msg) != SQLITE_OK) {
+    std::cerr << "SQL error: " << err_msg << "\n";
+    sqlite3_free(err_msg);
+  }
+  add_missing_columns();
+
+  sql = "CREATE TABLE IF NOT EXISTS page_history ("
+        "url TEXT NOT NULL,"
+        "fetched_at INTEGER NOT NULL,"
+        "content_hash INTEGER,"
+        "changed INTEGER NOT NULL );"
+        "CREATE INDEX IF NOT EXISTS page_history_url "
+        "ON page_history (url, fetched_at);"
+        "CREATE TABLE IF NOT EXISTS dictionaries ("
+        "id INTEGER PRIMARY KEY,"
+        "domain TEXT NOT NULL,"
+        "data BLOB NOT NULL );";
   if (sqlite3_exec(db, sql.c_str(), nullptr, 0, &err_msg) != SQLITE_OK) {
     std::cerr << "SQL error: " << err_msg << "\n";
     sqlite3_free(err_msg);
   }
+  load_dictionaries();
+}
+
+void Database::add_missing_columns() {
+  static const std::vector<std::pair<std::string, std::string>> columns = {
+      {"etag", "TEXT"},           {"last_modified", "TEXT"},
+      {"http_status", "INTEGER"}, {"fetched_at", "INTEGER"},
+      {"body_bytes", "INTEGER"},  {"parse_ms", "REAL"},
+      {"content_zstd", "BLOB"},   {"dict_id", "INTEGER"}};
+
+  std::unordered_set<std::string> existing;
+  sqlite3_stmt *raw_stmt;
+  if (sqlite3_prepare_v2(db, "PRAGMA table_info(pages);", -1, &raw_stmt,
+                         nullptr) != SQLITE_OK) {
+    std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << "\n";
+    return;
+  }
+  {
+    StmtGuard stmt(raw_stmt);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      existing.insert(
+          reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)));
+    }
+  }
+
+  for (const auto &column : columns) {
+    if (existing.count(column.first))
+      continue;
+    std::string sql = "ALTER TABLE pages ADD COLUMN " + column.first + " " +
+                      column.second + ";";
+    char *err_msg = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, 0, &err_msg) != SQLITE_OK) {
+      std::cerr << "SQL error: " << err_msg << "\n";
+      sqlite3_free(err_msg);
+    }
+  }
+}
+
+sqlite3_stmt *Database::cached_statement(const char *sql) {
+  auto it = statements_.find(sql);
+  if (it != statements_.end())
+    return it->second;
+
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt,
+                         nullptr) != SQLITE_OK) {
+    std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << "\n";
+    return nullptr;
+  }
+  statements_.emplace(sql, stmt);
+  return stmt;
+}
+
+void Database::set_batching(size_t batch_rows, int batch_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  batch_rows_ = batch_rows ? batch_rows : 1;
+  batch_ms_ = batch_ms;
+}
+
+void Database::begin_write() {
+  if (in_transaction_ || batch_rows_ <= 1)
+    return;
+
+  char *err_msg = nullptr;
+  if (sqlite3_exec(db, "BEGIN;", nullptr, 0, &err_msg) != SQLITE_OK) {
+    std::cerr << "SQL error: " << err_msg << "\n";
+    sqlite3_free(err_msg);
+    return;
+  }
+  in_transaction_ = true;
+  batch_started_ = std::chrono::steady_clock::now();
+}
+
+void Database::end_write() {
+  if (!in_transaction_)
+    return;
+
+  ++pending_rows_;
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - batch_started_)
+                     .count();
+  if (pending_rows_ >= batch_rows_ || elapsed >= batch_ms_)
+    commit();
+}
+
+void Database::commit() {
+  if (!in_transaction_)
+    return;
+
+  char *err_msg = nullptr;
+  if (sqlite3_exec(db, "COMMIT;", nullptr, 0, &err_msg) != SQLITE_OK) {
+    std::cerr << "SQL error: " << err_msg << "\n";
+    sqlite3_free(err_msg);
+  }
+  in_transaction_ = false;
+  pending_rows_ = 0;
+}
+
+void Database::flush() {
+  if (writer_) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    ++flush_waiters_;
+    queue_not_empty_.notify_one();
+    writer_idle_.wait(lock, [this] { return writes_in_flight_ == 0; });
+    --flush_waiters_;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (db)
+    commit();
+}
+
+void Database::start_writer(size_t queue_capacity) {
+  if (!db || writer_)
+    return;
+  flush();
+  queue_capacity_ = queue_capacity ? queue_capacity : 1;
+  stop_writer_ = false;
+  writer_ = std::make_unique<std::thread>(&Database::writer_loop, this);
+}
+
+void Database::stop_writer() {
+  if (!writer_)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stop_writer_ = true;
+  }
+  queue_not_empty_.notify_all();
+  writer_->join();
+  writer_.reset();
+}
+
+void Database::submit(PendingWrite write) {
+  if (!db) {
+    std::cerr << "Database is not connected." << std::endl;
+    return;
+  }
+
+  if (writer_) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_not_full_.wait(
+        lock, [this] { return write_queue_.size() < queue_capacity_; });
+    write_queue_.push_back(std::move(write));
+    ++writes_in_flight_;
+    lock.unlock();
+    queue_not_empty_.notify_one();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  begin_write();
+  apply(write);
+  end_write();
+}
+
+void Database::writer_loop() {
+  std::vector<PendingWrite> batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_not_empty_.wait(
+          lock, [this] { return !write_queue_.empty() || stop_writer_; });
+      if (write_queue_.empty())
+        break;
+
+      auto deadline = std::chrono::steady_clock::now() +
+                      std::chrono::milliseconds(batch_ms_);
+      queue_not_empty_.wait_until(lock, deadline, [this] {
+        return write_queue_.size() >= batch_rows_ || stop_writer_ ||
+               flush_waiters_ > 0;
+      });
+
+      MetricsCollector::instance().record_gauge("db_writer_queue_depth",
+                                                write_queue_.size());
+      size_t take = std::min(write_queue_.size(), batch_rows_);
+      for (size_t i = 0; i < take; ++i) {
+        batch.push_back(std::move(write_queue_.front()));
+        write_queue_.pop_front();
+      }
+    }
+    queue_not_full_.notify_all();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      bool grouped = batch.size() > 1;
+      if (grouped)
+        sqlite3_exec(db, "BEGIN;", nullptr, 0, nullptr);
+      for (const auto &write : batch)
+        apply(write);
+      if (grouped && sqlite3_exec(db, "COMMIT;", nullptr, 0, nullptr) !=
+                         SQLITE_OK)
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << "\n";
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(
+                            std::chrono::high_resolution_clock::now() - start)
+                            .count();
+    MetricsCollector::instance().record_metric("db_commit", elapsed_ms);
+    MetricsCollector::instance().increment_counter("db_rows_written",
+                                                   batch.size());
+
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      writes_in_flight_ -= batch.size();
+    }
+    writer_idle_.notify_all();
+    batch.clear();
+  }
+}
+
+void Database::apply(const PendingWrite &write) {
+  switch (write.kind) {
+  case PendingWrite::INSERT:
+    write_page("INSERT INTO pages (url, content, etag, last_modified, "
+               "http_status, fetched_at, body_bytes, parse_ms, "
+               "content_zstd, dict_id) "
+               "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+               "ON CONFLICT(url) DO NOTHING;",
+               write);
+    break;
+  case PendingWrite::UPSERT:
+    write_page(
+        "INSERT INTO pages (url, content, etag, last_modified, "
+        "http_status, fetched_at, body_bytes, parse_ms, "
+        "content_zstd, dict_id) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+        "ON CONFLICT(url) DO UPDATE SET content = excluded.content, "
+        "etag = excluded.etag, last_modified = excluded.last_modified, "
+        "http_status = excluded.http_status, "
+        "fetched_at = excluded.fetched_at, "
+        "body_bytes = excluded.body_bytes, parse_ms = excluded.parse_ms, "
+        "content_zstd = excluded.content_zstd, dict_id = excluded.dict_id;",
+        write);
+    break;
+  case PendingWrite::NOT_MODIFIED:
+    write_not_modified(write);
+    break;
+  case PendingWrite::HISTORY:
+    write_history(write);
+    break;
+  case PendingWrite::DICTIONARY:
+    write_dictionary(write);
+    break;
+  }
 }
 
 bool Database::is_url_processed(const std::string &url) {
@@ -44,14 +449,12 @@ bool Database::is_url_processed(const std::string &url) {
     return false;
   }
   std::string normalized_url = UrlUtils::normalize_url(url);
-  sqlite3_stmt *raw_stmt;
-  std::string sql = "SELECT 1 FROM pages WHERE url = ? LIMIT 1;";
-  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &raw_stmt, nullptr) !=
-      SQLITE_OK) {
-    std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << "\n";
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(
+      cached_statement("SELECT 1 FROM pages WHERE url = ? LIMIT 1;"));
+  if (!stmt)
     return false;
-  }
-  StmtGuard stmt(raw_stmt);
 
   if (sqlite3_bind_text(stmt, 1, normalized_url.c_str(), -1, SQLITE_STATIC) !=
       SQLITE_OK) {
@@ -69,40 +472,490 @@ bool Database::is_url_processed(const std::string &url) {
   return exists;
 }
 
-void Database::insert_page(const std::string &url, const std::string &text) {
-  if (!db) {
-    std::cerr << "Database is not connected." << std::endl;
-    return;
-  }
-  std::string normalized_url = UrlUtils::normalize_url(url);
-  sqlite3_stmt *raw_stmt;
-  std::string sql = "INSERT INTO pages (url, content) VALUES (?, ?);";
-  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &raw_stmt, nullptr) !=
-      SQLITE_OK) {
-    std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << "\n";
+void Database::write_page(const char *sql, const PendingWrite &write) {
+  std::string normalized_url = UrlUtils::normalize_url(write.url);
+  CachedStmt stmt(cached_statement(sql));
+  if (!stmt)
     return;
-  }
-  StmtGuard stmt(raw_stmt);
 
   if (sqlite3_bind_text(stmt, 1, normalized_url.c_str(), -1, SQLITE_STATIC) !=
       SQLITE_OK) {
     std::cerr << "Failed to bind URL: " << sqlite3_errmsg(db) << "\n";
     return;
   }
-  if (sqlite3_bind_text(stmt, 2, text.c_str(), -1, SQLITE_STATIC) !=
-      SQLITE_OK) {
+  int rc = write.compressed.empty()
+               ? sqlite3_bind_text(stmt, 2, write.text.c_str(), -1,
+                                   SQLITE_STATIC)
+               : sqlite3_bind_blob(stmt, 9, write.compressed.data(),
+                                   write.compressed.size(), SQLITE_STATIC);
+  if (rc != SQLITE_OK) {
     std::cerr << "Failed to bind content: " << sqlite3_errmsg(db) << "\n";
     return;
   }
+  bind_fetch_info(stmt, 3, write.info);
+  if (write.dict_id)
+    sqlite3_bind_int64(stmt, 10, write.dict_id);
 
-  int result = sqlite3_step(stmt);
-  if (result != SQLITE_DONE)
+  bool index = fts_mode_ == FtsMode::ON_INSERT;
+  long long id = index && write.kind == PendingWrite::UPSERT
+                     ? unindex_page(normalized_url)
+                     : 0;
+
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
     std::cerr << "Error executing query: " << sqlite3_errmsg(db) << "\n";
+    return;
+  }
+  if (!index || (!id && sqlite3_changes(db) == 0))
+    return;
+  index_page(id ? id : sqlite3_last_insert_rowid(db), write.text);
+}
+
+void Database::index_page(long long id, const std::string &text) {
+  CachedStmt stmt(cached_statement(
+      "INSERT INTO pages_fts (rowid, content) VALUES (?, ?);"));
+  if (!stmt)
+    return;
+
+  sqlite3_bind_int64(stmt, 1, id);
+  sqlite3_bind_text(stmt, 2, text.c_str(), -1, SQLITE_STATIC);
+  if (sqlite3_step(stmt) != SQLITE_DONE)
+    std::cerr << "Error executing query: " << sqlite3_errmsg(db) << "\n";
+}
+
+long long Database::unindex_page(const std::string &normalized_url) {
+  long long id = 0;
+  std::string text;
+  {
+    CachedStmt stmt(cached_statement("SELECT id, content, content_zstd, "
+                                     "dict_id FROM pages WHERE url = ?;"));
+    if (!stmt)
+      return 0;
+
+    sqlite3_bind_text(stmt, 1, normalized_url.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) != SQLITE_ROW)
+      return 0;
+
+    id = sqlite3_column_int64(stmt, 0);
+    if (sqlite3_column_type(stmt, 2) == SQLITE_NULL) {
+      const unsigned char *value = sqlite3_column_text(stmt, 1);
+      text = value ? reinterpret_cast<const char *>(value) : "";
+    } else if (!decompress_content(sqlite3_column_blob(stmt, 2),
+                                   sqlite3_column_bytes(stmt, 2),
+                                   sqlite3_column_int64(stmt, 3), text)) {
+      return id;
+    }
+  }
+
+  CachedStmt stmt(cached_statement("INSERT INTO pages_fts (pages_fts, rowid, "
+                                   "content) VALUES ('delete', ?, ?);"));
+  if (!stmt)
+    return id;
+
+  sqlite3_bind_int64(stmt, 1, id);
+  sqlite3_bind_text(stmt, 2, text.c_str(), -1, SQLITE_STATIC);
+  if (sqlite3_step(stmt) != SQLITE_DONE)
+    std::cerr << "Error executing query: " << sqlite3_errmsg(db) << "\n";
+  return id;
+}
+
+bool Database::has_table(const std::string &name) {
+  if (!db)
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(cached_statement(
+      "SELECT 1 FROM sqlite_master WHERE name = ? LIMIT 1;"));
+  if (!stmt)
+    return false;
+
+  sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+  return sqlite3_step(stmt) == SQLITE_ROW;
+}
+
+long long Database::data_version() {
+  if (!db)
+    return 0;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(cached_statement("PRAGMA data_version;"));
+  if (!stmt || sqlite3_step(stmt) != SQLITE_ROW)
+    return 0;
+  return sqlite3_column_int64(stmt, 0);
+}
+
+FtsMode Database::parse_fts_mode(const std::string &mode) {
+  if (mode == "off")
+    return FtsMode::OFF;
+  if (mode == "bulk")
+    return FtsMode::BULK;
+  return FtsMode::ON_INSERT;
+}
+
+void Database::set_fts_mode(FtsMode mode) {
+  if (!db)
+    return;
+
+  bool existed = has_table("pages_fts");
+  std::lock_guard<std::mutex> lock(mutex_);
+  fts_mode_ = mode;
+  if (mode == FtsMode::OFF) {
+    sqlite3_exec(db, "DROP TABLE IF EXISTS pages_fts;", nullptr, 0, nullptr);
+  } else if (mode == FtsMode::ON_INSERT && !existed) {
+    populate_fts();
+  }
+}
+
+void Database::build_fts() {
+  if (!db)
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  populate_fts();
+}
+
+void Database::populate_fts() {
+  auto start = std::chrono::high_resolution_clock::now();
+  char *err_msg = nullptr;
+  if (sqlite3_exec(db,
+                   "BEGIN;"
+                   "DROP TABLE IF EXISTS pages_fts;"
+                   "CREATE VIRTUAL TABLE pages_fts USING fts5("
+                   "content, content = '', "
+                   "tokenize = 'unicode61 remove_diacritics 2');"
+                   "INSERT INTO pages_fts (rowid, content) "
+                   "SELECT id, page_text(content, content_zstd, dict_id) "
+                   "FROM pages;"
+                   "INSERT INTO pages_fts (pages_fts) VALUES ('optimize');"
+                   "COMMIT;",
+                   nullptr, 0, &err_msg) != SQLITE_OK) {
+    std::cerr << "SQL error: " << err_msg << "\n";
+    sqlite3_free(err_msg);
+    sqlite3_exec(db, "ROLLBACK;", nullptr, 0, nullptr);
+    return;
+  }
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::high_resolution_clock::now() - start)
+                          .count();
+  MetricsCollector::instance().record_metric("fts_build", elapsed_ms);
+}
+
+void Database::write_not_modified(const PendingWrite &write) {
+  std::string normalized_url = UrlUtils::normalize_url(write.url);
+  CachedStmt stmt(
+      cached_statement("UPDATE pages SET etag = ?, last_modified = ?, "
+                       "http_status = ?, fetched_at = ? WHERE url = ?;"));
+  if (!stmt)
+    return;
+
+  sqlite3_bind_text(stmt, 1, write.info.etag.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, write.info.last_modified.c_str(), -1,
+                    SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 3, write.info.http_status);
+  sqlite3_bind_int64(stmt, 4, write.info.fetched_at);
+  sqlite3_bind_text(stmt, 5, normalized_url.c_str(), -1, SQLITE_STATIC);
+
+  if (sqlite3_step(stmt) != SQLITE_DONE)
+    std::cerr << "Error executing query: " << sqlite3_errmsg(db) << "\n";
+}
+
+void Database::write_dictionary(const PendingWrite &write) {
+  CachedStmt stmt(cached_statement(
+      "INSERT OR REPLACE INTO dictionaries (id, domain, data) "
+      "VALUES (?, ?, ?);"));
+  if (!stmt)
+    return;
+
+  sqlite3_bind_int64(stmt, 1, write.dict_id);
+  sqlite3_bind_text(stmt, 2, write.url.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_blob(stmt, 3, write.text.data(), write.text.size(),
+                    SQLITE_STATIC);
+
+  if (sqlite3_step(stmt) != SQLITE_DONE)
+    std::cerr << "Error executing query: " << sqlite3_errmsg(db) << "\n";
+}
+
+void Database::encode_content(PendingWrite &write) {
+  if (!compress_)
+    return;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  ZstdDictionary trained;
+  if (!codec_.compress(UrlUtils::extract_domain(write.url), write.text,
+                       write.compressed, write.dict_id, &trained))
+    return;
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::high_resolution_clock::now() - start)
+                          .count();
+
+  if (write.compressed.size() >= write.text.size()) {
+    write.compressed.clear();
+    write.dict_id = 0;
+  }
+
+  auto &metrics = MetricsCollector::instance();
+  metrics.record_metric("zstd_compress", elapsed_ms);
+  metrics.increment_counter("content_bytes_raw", write.text.size());
+  metrics.increment_counter("content_bytes_stored",
+                            write.compressed.empty() ? write.text.size()
+                                                     : write.compressed.size());
 
-  return;
+  // The dictionary row is queued before any page can be compressed with
+  // it, so no commit ever holds pages whose dictionary is missing.
+  if (trained.id) {
+    metrics.increment_counter("zstd_dictionaries_trained");
+    PendingWrite dictionary(PendingWrite::DICTIONARY, trained.domain,
+                            trained.data, PageFetchInfo());
+    dictionary.dict_id = trained.id;
+    submit(std::move(dictionary));
+    codec_.add_dictionary(trained);
+  }
+  if (!write.compressed.empty() && fts_mode_ != FtsMode::ON_INSERT)
+    write.text.clear();
+}
+
+bool Database::decompress_content(const void *data, size_t size,
+                                  long long dict_id, std::string &text) {
+  auto start = std::chrono::high_resolution_clock::now();
+  bool ok = codec_.decompress(data, size, dict_id, text);
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::high_resolution_clock::now() - start)
+                          .count();
+  MetricsCollector::instance().record_metric("zstd_decompress", elapsed_ms,
+                                             ok);
+  return ok;
+}
+
+void Database::insert_page(const std::string &url, const std::string &text,
+                           const PageFetchInfo &info) {
+  PendingWrite write(PendingWrite::INSERT, url, text, info);
+  encode_content(write);
+  submit(std::move(write));
 }
+
+void Database::upsert_page(const std::string &url, const std::string &text,
+                           const PageFetchInfo &info) {
+  PendingWrite write(PendingWrite::UPSERT, url, text, info);
+  encode_content(write);
+  submit(std::move(write));
+}
+
+bool Database::get_page_text(const std::string &url, std::string &text) {
+  if (!db) {
+    std::cerr << "Database is not connected." << std::endl;
+    return false;
+  }
+  std::string normalized_url = UrlUtils::normalize_url(url);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(cached_statement("SELECT content, content_zstd, dict_id "
+                                   "FROM pages WHERE url = ? LIMIT 1;"));
+  if (!stmt)
+    return false;
+
+  sqlite3_bind_text(stmt, 1, normalized_url.c_str(), -1, SQLITE_STATIC);
+  if (sqlite3_step(stmt) != SQLITE_ROW)
+    return false;
+
+  if (sqlite3_column_type(stmt, 1) == SQLITE_NULL) {
+    const unsigned char *value = sqlite3_column_text(stmt, 0);
+    text = value ? reinterpret_cast<const char *>(value) : "";
+    return true;
+  }
+  return decompress_content(sqlite3_column_blob(stmt, 1),
+                            sqlite3_column_bytes(stmt, 1),
+                            sqlite3_column_int64(stmt, 2), text);
+}
+
+void Database::mark_not_modified(const std::string &url,
+                                 const PageFetchInfo &info) {
+  submit(PendingWrite(PendingWrite::NOT_MODIFIED, url, "", info));
+}
+
+bool Database::get_fetch_info(const std::string &url, PageFetchInfo &info) {
+  if (!db) {
+    std::cerr << "Database is not connected." << std::endl;
+    return false;
+  }
+  std::string normalized_url = UrlUtils::normalize_url(url);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(cached_statement(
+      "SELECT etag, last_modified, http_status, fetched_at, "
+      "body_bytes, parse_ms FROM pages WHERE url = ? LIMIT 1;"));
+  if (!stmt)
+    return false;
+
+  sqlite3_bind_text(stmt, 1, normalized_url.c_str(), -1, SQLITE_STATIC);
+  if (sqlite3_step(stmt) != SQLITE_ROW)
+    return false;
+
+  auto column_text = [&stmt](int column) {
+    const unsigned char *value = sqlite3_column_text(stmt, column);
+    return value ? std::string(reinterpret_cast<const char *>(value))
+                 : std::string();
+  };
+  info.etag = column_text(0);
+  info.last_modified = column_text(1);
+  info.http_status = sqlite3_column_int64(stmt, 2);
+  info.fetched_at = sqlite3_column_int64(stmt, 3);
+  info.body_bytes = sqlite3_column_int64(stmt, 4);
+  info.parse_ms = sqlite3_column_double(stmt, 5);
+  return true;
+}
+
+std::vector<std::string> Database::get_page_urls() {
+  std::vector<std::string> urls;
+  if (!db) {
+    std::cerr << "Database is not connected." << std::endl;
+    return urls;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(cached_statement("SELECT url FROM pages;"));
+  if (!stmt)
+    return urls;
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const unsigned char *url = sqlite3_column_text(stmt, 0);
+    if (url)
+      urls.emplace_back(reinterpret_cast<const char *>(url));
+  }
+  return urls;
+}
+
+size_t Database::scan_pages(
+    const std::function<void(const std::string &, const std::string &)>
+        &callback) {
+  if (!db) {
+    std::cerr << "Database is not connected." << std::endl;
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(cached_statement("SELECT url, content, content_zstd, "
+                                   "dict_id FROM pages ORDER BY id;"));
+  if (!stmt)
+    return 0;
+
+  size_t count = 0;
+  std::string text;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const unsigned char *url = sqlite3_column_text(stmt, 0);
+    if (!url)
+      continue;
+    if (sqlite3_column_type(stmt, 2) == SQLITE_NULL) {
+      const unsigned char *value = sqlite3_column_text(stmt, 1);
+      text = value ? reinterpret_cast<const char *>(value) : "";
+    } else if (!decompress_content(sqlite3_column_blob(stmt, 2),
+                                   sqlite3_column_bytes(stmt, 2),
+                                   sqlite3_column_int64(stmt, 3), text)) {
+      continue;
+    }
+    callback(reinterpret_cast<const char *>(url), text);
+    ++count;
+  }
+  return count;
+}
+
+void Database::record_fetch(const std::string &url, long long fetched_at,
+                            uint64_t content_hash, bool not_modified) {
+  PageFetchInfo info;
+  info.fetched_at = fetched_at;
+  PendingWrite write(PendingWrite::HISTORY, url, "", info);
+  write.content_hash = content_hash;
+  write.not_modified = not_modified;
+  submit(std::move(write));
+}
+
+void Database::write_history(const PendingWrite &write) {
+  std::string normalized_url = UrlUtils::normalize_url(write.url);
+  sqlite3_int64 hash = static_cast<sqlite3_int64>(write.content_hash);
+  bool changed = false;
+
+  {
+    CachedStmt stmt(cached_statement(
+        "SELECT content_hash FROM page_history WHERE url = ? "
+        "ORDER BY fetched_at DESC, rowid DESC LIMIT 1;"));
+    if (!stmt)
+      return;
+
+    sqlite3_bind_text(stmt, 1, normalized_url.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      sqlite3_int64 previous = sqlite3_column_int64(stmt, 0);
+      if (write.not_modified) {
+        hash = previous;
+      } else {
+        changed = previous != hash;
+      }
+    }
+  }
+
+  CachedStmt stmt(cached_statement(
+      "INSERT INTO page_history (url, fetched_at, content_hash, changed) "
+      "VALUES (?, ?, ?, ?);"));
+  if (!stmt)
+    return;
+
+  sqlite3_bind_text(stmt, 1, normalized_url.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, write.info.fetched_at);
+  sqlite3_bind_int64(stmt, 3, hash);
+  sqlite3_bind_int(stmt, 4, changed ? 1 : 0);
+
+  if (sqlite3_step(stmt) != SQLITE_DONE)
+    std::cerr << "Error executing query: " << sqlite3_errmsg(db) << "\n";
+}
+
+std::vector<PageHistorySummary> Database::get_history_summaries() {
+  std::vector<PageHistorySummary> summaries;
+  if (!db) {
+    std::cerr << "Database is not connected." << std::endl;
+    return summaries;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(
+      cached_statement("SELECT url, COUNT(*), SUM(changed), MIN(fetched_at), "
+                       "MAX(fetched_at) FROM page_history GROUP BY url;"));
+  if (!stmt)
+    return summaries;
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    PageHistorySummary summary;
+    summary.url = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    summary.visits = sqlite3_column_int64(stmt, 1);
+    summary.changes = sqlite3_column_int64(stmt, 2);
+    summary.first_fetched = sqlite3_column_int64(stmt, 3);
+    summary.last_fetched = sqlite3_column_int64(stmt, 4);
+    summaries.push_back(summary);
+  }
+  return summaries;
+}
+
+size_t Database::count_fetches_since(long long since) {
+  if (!db) {
+    std::cerr << "Database is not connected." << std::endl;
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CachedStmt stmt(cached_statement(
+      "SELECT COUNT(*) FROM page_history WHERE fetched_at >= ?;"));
+  if (!stmt)
+    return 0;
+
+  sqlite3_bind_int64(stmt, 1, since);
+  if (sqlite3_step(stmt) != SQLITE_ROW)
+    return 0;
+  return sqlite3_column_int64(stmt, 0);
+}
+
 Database::~Database() {
-  if (db)
+  stop_writer();
+  if (db) {
+    commit();
+    for (auto &statement : statements_)
+      sqlite3_finalize(statement.second);
     sqlite3_close(db);
+  }
 }
 sqlite3 *Database::get_db() { return db; }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "../../inc/html_scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTML_SCANNER_X86 1
+#endif
+
+struct CharClass {
+  unsigned char chars[8];
+  int count;
+  bool member[256];
+
+  CharClass(const char *set) : chars(), count(0), member() {
+    for (; *set && count < 8; ++set) {
+      chars[count++] = static_cast<unsigned char>(*set);
+      member[static_cast<unsigned char>(*set)] = true;
+    }
+  }
+};
+
+static const CharClass text_special("<&\t\n\r\f");
+static const CharClass tag_delimiter(">=/ \t\n\r");
+
+static const CharClass &char_class(HtmlScanner::CharSet set) {
+  return set == HtmlScanner::TEXT_SPECIAL ? text_special : tag_delimiter;
+}
+
+static const char *find_scalar(const char *p, const char *end,
+                               const CharClass &cls) {
+  for (; p < end; ++p) {
+    if (cls.member[static_cast<unsigned char>(*p)])
+      return p;
+  }
+  return end;
+}
+
+#ifdef HTML_SCANNER_X86
+__attribute__((target("sse2"))) static const char *
+find_sse2(const char *p, const char *end, const CharClass &cls) {
+  __m128i needles[8];
+  for (int i = 0; i < cls.count; ++i)
+    needles[i] = _mm_set1_epi8(static_cast<char>(cls.chars[i]));
+
+  while (end - p >= 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+    for (int i = 1; i < cls.count; ++i)
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return find_scalar(p, end, cls);
+}
+
+__attribute__((target("avx2"))) static const char *
+find_avx2(const char *p, const char *end, const CharClass &cls) {
+  __m256i needles[8];
+  for (int i = 0; i < cls.count; ++i)
+    needles[i] = _mm256_set1_epi8(static_cast<char>(cls.chars[i]));
+
+  while (end - p >= 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i hits = _mm256_cmpeq_epi8(block, needles[0]);
+    for (int i = 1; i < cls.count; ++i)
+      hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[i]));
+
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return find_sse2(p, end, cls);
+}
+#endif
+
+typedef const char *(*FindFunction)(const char *, const char *,
+                                    const CharClass &);
+
+struct ScannerBackend {
+  FindFunction find;
+  const char *name;
+};
+
+static ScannerBackend select_backend() {
+#ifdef HTML_SCANNER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return {find_avx2, "avx2"};
+  if (__builtin_cpu_supports("sse2"))
+    return {find_sse2, "sse2"};
+#endif
+  return {find_scalar, "scalar"};
+}
+
+static const ScannerBackend &backend() {
+  static const ScannerBackend selected = select_backend();
+  return selected;
+}
+
+const char *HtmlScanner::find(const char *begin, const char *end,
+                              CharSet set) {
+  return backend().find(begin, end, char_class(set));
+}
+
+const char *HtmlScanner::backend_name() { return backend().name; }
\ No newline at end of file
@@ -0,0 +1,613 @@
+#include "../../inc/html_tokenizer.h"
+#include "../../inc/html_scanner.h"
+#include "../../inc/url_utils.h"
+#include <cctype>
+#include <cstring>
+
+static const size_t kMaxPending = 256 * 1024;
+static const long kMaxEntityLength = 32;
+
+enum class TagKind { OTHER, A, BASE, LINK, META, TITLE, SCRIPT, STYLE };
+
+struct NamedEntity {
+  const char *name;
+  const char *value;
+};
+
+static const NamedEntity named_entities[] = {
+    {"amp", "&"},
+    {"lt", "<"},
+    {"gt", ">"},
+    {"quot", "\""},
+    {"apos", "'"},
+    {"nbsp", " "},
+    {"copy", "\xC2\xA9"},
+    {"reg", "\xC2\xAE"},
+    {"trade", "\xE2\x84\xA2"},
+    {"mdash", "\xE2\x80\x94"},
+    {"ndash", "\xE2\x80\x93"},
+    {"hellip", "\xE2\x80\xA6"},
+    {"laquo", "\xC2\xAB"},
+    {"raquo", "\xC2\xBB"},
+    {"lsquo", "\xE2\x80\x98"},
+    {"rsquo", "\xE2\x80\x99"},
+    {"ldquo", "\xE2\x80\x9C"},
+    {"rdquo", "\xE2\x80\x9D"},
+    {"deg", "\xC2\xB0"},
+    {"frac12", "\xC2\xBD"}};
+
+static inline bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static inline bool is_alpha(char c) {
+  char lower = c | 0x20;
+  return lower >= 'a' && lower <= 'z';
+}
+
+static inline char to_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static bool equals_ci(const char *data, size_t size, const char *lower) {
+  size_t i = 0;
+  for (; i < size; ++i) {
+    if (!lower[i] || to_lower(data[i]) != lower[i])
+      return false;
+  }
+  return lower[i] == '\0';
+}
+
+static bool starts_with_ci(const char *data, size_t size, const char *lower) {
+  size_t i = 0;
+  for (; lower[i]; ++i) {
+    if (i >= size || to_lower(data[i]) != lower[i])
+      return false;
+  }
+  return true;
+}
+
+static TagKind classify_tag(const char *name, size_t size) {
+  switch (size) {
+  case 1:
+    return to_lower(name[0]) == 'a' ? TagKind::A : TagKind::OTHER;
+  case 4:
+    if (equals_ci(name, size, "base"))
+      return TagKind::BASE;
+    if (equals_ci(name, size, "link"))
+      return TagKind::LINK;
+    if (equals_ci(name, size, "meta"))
+      return TagKind::META;
+    return TagKind::OTHER;
+  case 5:
+    if (equals_ci(name, size, "title"))
+      return TagKind::TITLE;
+    if (equals_ci(name, size, "style"))
+      return TagKind::STYLE;
+    return TagKind::OTHER;
+  case 6:
+    return equals_ci(name, size, "script") ? TagKind::SCRIPT : TagKind::OTHER;
+  default:
+    return TagKind::OTHER;
+  }
+}
+
+static bool is_canonical_rel(const std::string &rel) {
+  size_t i = 0;
+  while (i < rel.size()) {
+    while (i < rel.size() && is_space(rel[i]))
+      ++i;
+    size_t start = i;
+    while (i < rel.size() && !is_space(rel[i]))
+      ++i;
+    if (equals_ci(rel.data() + start, i - start, "canonical"))
+      return true;
+  }
+  return false;
+}
+
+static void append_utf8(std::string &out, unsigned long cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+// Returns 1 when an entity was decoded, 0 when the '&' is literal and -1 when
+// more input is needed to decide.
+static int match_entity(const char *p, const char *end, std::string &out,
+                        const char **next) {
+  const char *limit = end - p > kMaxEntityLength ? p + kMaxEntityLength : end;
+  const char *q = p + 1;
+
+  if (q < limit && *q == '#') {
+    ++q;
+    bool hex = q < limit && (*q == 'x' || *q == 'X');
+    if (hex)
+      ++q;
+
+    const char *digits = q;
+    unsigned long cp = 0;
+    while (q < limit && (hex ? std::isxdigit(static_cast<unsigned char>(*q))
+                             : std::isdigit(static_cast<unsigned char>(*q)))) {
+      int digit = std::isdigit(static_cast<unsigned char>(*q))
+                      ? *q - '0'
+                      : to_lower(*q) - 'a' + 10;
+      cp = cp > 0x10FFFF ? cp : cp * (hex ? 16 : 10) + digit;
+      ++q;
+    }
+    if (q == limit)
+      return limit == end ? -1 : 0;
+    if (*q != ';' || q == digits)
+      return 0;
+
+    if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+      cp = 0xFFFD;
+    if (cp == 0xA0)
+      out = " ";
+    else
+      append_utf8(out, cp);
+    *next = q + 1;
+    return 1;
+  }
+
+  const char *name = q;
+  while (q < limit && std::isalnum(static_cast<unsigned char>(*q)))
+    ++q;
+  if (q == limit)
+    return limit == end ? -1 : 0;
+  if (*q != ';' || q == name)
+    return 0;
+
+  size_t size = q - name;
+  for (const auto &entity : named_entities) {
+    if (std::strlen(entity.name) == size &&
+        std::memcmp(entity.name, name, size) == 0) {
+      out = entity.value;
+      *next = q + 1;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static std::string decode_attribute(const char *p, size_t size) {
+  const char *end = p + size;
+  std::string value;
+  value.reserve(size);
+
+  while (p < end) {
+    const char *amp = static_cast<const char *>(std::memchr(p, '&', end - p));
+    if (!amp) {
+      value.append(p, end - p);
+      break;
+    }
+    value.append(p, amp - p);
+
+    std::string decoded;
+    const char *next = nullptr;
+    if (match_entity(amp, end, decoded, &next) == 1) {
+      value += decoded;
+      p = next;
+    } else {
+      value += '&';
+      p = amp + 1;
+    }
+  }
+  return value;
+}
+
+static void trim_trailing_space(std::string &text) {
+  while (!text.empty() && text.back() == ' ')
+    text.pop_back();
+}
+
+HtmlTokenizer::HtmlTokenizer(ParsedPage &page, const std::string &base_url)
+    : page_(page), initial_base_url_(base_url), base_url_(base_url) {}
+
+void HtmlTokenizer::set_base_url(const std::string &base_url) {
+  initial_base_url_ = base_url;
+  if (!base_seen_)
+    base_url_ = base_url;
+}
+
+void HtmlTokenizer::reset() {
+  page_ = ParsedPage();
+  base_url_ = initial_base_url_;
+  pending_.clear();
+  state_ = State::TEXT;
+  raw_tag_ = nullptr;
+  comment_dashes_ = 0;
+  last_was_whitespace_ = true;
+  in_title_ = false;
+  base_seen_ = false;
+}
+
+void HtmlTokenizer::feed(const char *data, size_t size) {
+  if (pending_.empty()) {
+    size_t consumed = process(data, data + size, false);
+    pending_.assign(data + consumed, size - consumed);
+  } else {
+    pending_.append(data, size);
+    size_t consumed =
+        process(pending_.data(), pending_.data() + pending_.size(), false);
+    pending_.erase(0, consumed);
+  }
+
+  if (pending_.size() > kMaxPending) {
+    process(pending_.data(), pending_.data() + pending_.size(), true);
+    pending_.clear();
+  }
+}
+
+void HtmlTokenizer::finish() {
+  if (!pending_.empty()) {
+    process(pending_.data(), pending_.data() + pending_.size(), true);
+    pending_.clear();
+  }
+
+  trim_trailing_space(page_.text);
+  trim_trailing_space(page_.title);
+  size_t start = page_.title.find_first_not_of(' ');
+  page_.title.erase(0, start == std::string::npos ? page_.title.size() : start);
+}
+
+size_t HtmlTokenizer::process(const char *begin, const char *end,
+                              bool final) {
+  const char *p = begin;
+
+  while (p < end) {
+    const char *next = nullptr;
+
+    switch (state_) {
+    case State::COMMENT:
+      next = skip_comment(p, end);
+      break;
+    case State::RAW_TEXT:
+      next = skip_raw_text(p, end, final);
+      break;
+    case State::TEXT: {
+      const char *q = HtmlScanner::find(p, end, HtmlScanner::TEXT_SPECIAL);
+      if (q > p)
+        append_run(p, q);
+      if (q == end)
+        return end - begin;
+
+      if (*q == '<') {
+        next = parse_markup(q, end, final);
+      } else if (*q == '&') {
+        next = parse_entity(q, end, final);
+      } else {
+        append_space();
+        next = q + 1;
+      }
+
+      if (!next)
+        return q - begin;
+      break;
+    }
+    }
+
+    if (!next)
+      return p - begin;
+    p = next;
+  }
+
+  return p - begin;
+}
+
+const char *HtmlTokenizer::parse_markup(const char *p, const char *end,
+                                        bool final) {
+  if (end - p < 2) {
+    if (!final)
+      return nullptr;
+    append_text(p, 1);
+    return p + 1;
+  }
+
+  char c = p[1];
+
+  if (c == '!' || c == '?') {
+    if (c == '!' && end - p < 4)
+      return final ? end : nullptr;
+    if (c == '!' && p[2] == '-' && p[3] == '-') {
+      state_ = State::COMMENT;
+      comment_dashes_ = 0;
+      return p + 4;
+    }
+
+    const char *close =
+        static_cast<const char *>(std::memchr(p, '>', end - p));
+    if (!close)
+      return final ? end : nullptr;
+    append_space();
+    return close + 1;
+  }
+
+  if (c == '/') {
+    const char *close =
+        static_cast<const char *>(std::memchr(p, '>', end - p));
+    if (!close)
+      return final ? end : nullptr;
+
+    const char *name = p + 2;
+    const char *name_end =
+        HtmlScanner::find(name, close, HtmlScanner::TAG_DELIMITER);
+    if (equals_ci(name, name_end - name, "title"))
+      in_title_ = false;
+
+    append_space();
+    return close + 1;
+  }
+
+  if (is_alpha(c))
+    return parse_start_tag(p, end, final);
+
+  append_text(p, 1);
+  return p + 1;
+}
+
+const char *HtmlTokenizer::parse_start_tag(const char *p, const char *end,
+                                           bool final) {
+  const char *name = p + 1;
+  const char *q = HtmlScanner::find(name, end, HtmlScanner::TAG_DELIMITER);
+  if (q == end)
+    return final ? end : nullptr;
+
+  TagKind kind = classify_tag(name, q - name);
+  std::string href;
+  std::string meta_name;
+  std::string meta_content;
+  std::string rel;
+
+  while (true) {
+    while (q < end && (is_space(*q) || *q == '/'))
+      ++q;
+    if (q == end)
+      return final ? end : nullptr;
+    if (*q == '>') {
+      ++q;
+      break;
+    }
+
+    const char *attr = q;
+    q = HtmlScanner::find(q, end, HtmlScanner::TAG_DELIMITER);
+    size_t attr_size = q - attr;
+    while (q < end && is_space(*q))
+      ++q;
+    if (q == end)
+      return final ? end : nullptr;
+
+    const char *value = nullptr;
+    size_t value_size = 0;
+
+    if (*q == '=') {
+      ++q;
+      while (q < end && is_space(*q))
+        ++q;
+      if (q == end)
+        return final ? end : nullptr;
+
+      if (*q == '"' || *q == '\'') {
+        const char *close =
+            static_cast<const char *>(std::memchr(q + 1, *q, end - q - 1));
+        if (!close)
+          return final ? end : nullptr;
+        value = q + 1;
+        value_size = close - value;
+        q = close + 1;
+      } else {
+        value = q;
+        while (q < end && !is_space(*q) && *q != '>')
+          ++q;
+        if (q == end)
+          return final ? end : nullptr;
+        value_size = q - value;
+      }
+    } else if (attr_size == 0) {
+      ++q;
+      continue;
+    }
+
+    if (!value || attr_size == 0)
+      continue;
+
+    if ((kind == TagKind::A || kind == TagKind::BASE ||
+         kind == TagKind::LINK) &&
+        equals_ci(attr, attr_size, "href")) {
+      href = decode_attribute(value, value_size);
+    } else if (kind == TagKind::LINK && equals_ci(attr, attr_size, "rel")) {
+      rel.assign(value, value_size);
+    } else if (kind == TagKind::META && equals_ci(attr, attr_size, "name")) {
+      meta_name.assign(value, value_size);
+    } else if (kind == TagKind::META &&
+               equals_ci(attr, attr_size, "content")) {
+      meta_content = decode_attribute(value, value_size);
+    }
+  }
+
+  switch (kind) {
+  case TagKind::A:
+    add_link(href);
+    break;
+  case TagKind::BASE:
+    if (!base_seen_ && !href.empty()) {
+      base_seen_ = true;
+      base_url_ = base_url_.empty()
+                      ? href
+                      : UrlUtils::make_absolute_url(base_url_, href);
+    }
+    break;
+  case TagKind::LINK:
+    if (page_.canonical.empty() && !href.empty() && is_canonical_rel(rel)) {
+      page_.canonical = base_url_.empty()
+                            ? href
+                            : UrlUtils::make_absolute_url(base_url_, href);
+    }
+    break;
+  case TagKind::META:
+    if (equals_ci(meta_name.data(), meta_name.size(), "robots"))
+      page_.apply_robots_directives(meta_content);
+    break;
+  case TagKind::SCRIPT:
+  case TagKind::STYLE:
+    state_ = State::RAW_TEXT;
+    raw_tag_ = kind == TagKind::SCRIPT ? "script" : "style";
+    return q;
+  case TagKind::TITLE:
+    append_space();
+    in_title_ = true;
+    return q;
+  default:
+    break;
+  }
+
+  append_space();
+  return q;
+}
+
+const char *HtmlTokenizer::parse_entity(const char *p, const char *end,
+                                        bool final) {
+  std::string decoded;
+  const char *next = nullptr;
+  int matched = match_entity(p, end, decoded, &next);
+
+  if (matched < 0) {
+    if (!final)
+      return nullptr;
+    matched = 0;
+  }
+
+  if (matched == 0) {
+    append_text(p, 1);
+    return p + 1;
+  }
+
+  if (decoded == " ")
+    append_space();
+  else
+    append_text(decoded.data(), decoded.size());
+  return next;
+}
+
+const char *HtmlTokenizer::skip_comment(const char *p, const char *end) {
+  const char *close = static_cast<const char *>(std::memchr(p, '>', end - p));
+  const char *stop = close ? close : end;
+
+  int dashes = 0;
+  const char *t = stop;
+  while (t > p && t[-1] == '-' && dashes < 2) {
+    --t;
+    ++dashes;
+  }
+  if (t == p)
+    dashes = std::min(2, dashes + comment_dashes_);
+
+  if (!close) {
+    comment_dashes_ = dashes;
+    return end;
+  }
+
+  comment_dashes_ = 0;
+  if (dashes >= 2) {
+    state_ = State::TEXT;
+    append_space();
+  }
+  return close + 1;
+}
+
+const char *HtmlTokenizer::skip_raw_text(const char *p, const char *end,
+                                         bool final) {
+  size_t name_size = std::strlen(raw_tag_);
+  const char *q = p;
+
+  while (true) {
+    q = static_cast<const char *>(std::memchr(q, '<', end - q));
+    if (!q)
+      return end;
+
+    if (static_cast<size_t>(end - q) < name_size + 3) {
+      if (final)
+        return end;
+      return q == p ? nullptr : q;
+    }
+
+    char after = q[name_size + 2];
+    if (q[1] == '/' && starts_with_ci(q + 2, name_size, raw_tag_) &&
+        (is_space(after) || after == '>' || after == '/')) {
+      const char *close =
+          static_cast<const char *>(std::memchr(q, '>', end - q));
+      if (!close) {
+        if (final)
+          return end;
+        return q == p ? nullptr : q;
+      }
+      state_ = State::TEXT;
+      raw_tag_ = nullptr;
+      append_space();
+      return close + 1;
+    }
+    ++q;
+  }
+}
+
+void HtmlTokenizer::append_text(const char *data, size_t size) {
+  page_.text.append(data, size);
+  if (in_title_)
+    page_.title.append(data, size);
+  last_was_whitespace_ = false;
+}
+
+void HtmlTokenizer::append_run(const char *p, const char *end) {
+  if (last_was_whitespace_) {
+    while (p < end && *p == ' ')
+      ++p;
+  }
+
+  while (p < end) {
+    const char *gap =
+        static_cast<const char *>(memmem(p, end - p, "  ", 2));
+    const char *stop = gap ? gap + 1 : end;
+    append_text(p, stop - p);
+
+    if (!gap)
+      break;
+    p = stop;
+    while (p < end && *p == ' ')
+      ++p;
+  }
+
+  last_was_whitespace_ = page_.text.empty() || page_.text.back() == ' ';
+}
+
+void HtmlTokenizer::append_space() {
+  if (last_was_whitespace_)
+    return;
+  page_.text += ' ';
+  if (in_title_)
+    page_.title += ' ';
+  last_was_whitespace_ = true;
+}
+
+void HtmlTokenizer::add_link(const std::string &href) {
+  if (href.empty() || href[0] == '#' ||
+      starts_with_ci(href.data(), href.size(), "javascript:") ||
+      starts_with_ci(href.data(), href.size(), "mailto:")) {
+    return;
+  }
+
+  std::string link =
+      base_url_.empty() ? href : UrlUtils::make_absolute_url(base_url_, href);
+  page_.links.insert(std::move(link));
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "../../inc/htmlparser.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+// Matches whole comma or space separated tokens, so that values such as
+// "max-snippet:none" are not taken for "none".
+void ParsedPage::apply_robots_directives(const std::string &content) {
+  std::string directives = content;
+  std::transform(directives.begin(), directives.end(), directives.begin(),
+                 [](unsigned char c) {
+                   return c == ',' ? ' ' : static_cast<char>(std::tolower(c));
+                 });
+
+  std::istringstream stream(directives);
+  std::string token;
+  while (stream >> token) {
+    if (token == "none") {
+      noindex = true;
+      nofollow = true;
+    } else if (token == "noindex") {
+      noindex = true;
+    } else if (token == "nofollow") {
+      nofollow = true;
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "../../inc/index_builder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+IndexBuilder::IndexBuilder(const std::string &dir, size_t segment_docs)
+    : dir_(dir), segment_docs_(std::max<size_t>(segment_docs, 1)) {
+  std::error_code ec;
+  std::filesystem::create_directories(dir_, ec);
+
+  uint64_t previous = 0;
+  std::vector<std::string> names;
+  InvertedIndex::read_manifest(dir_, previous, names);
+  generation_ = previous + 1;
+}
+
+bool IndexBuilder::add_document(const std::string &url,
+                                const std::string &text) {
+  uint32_t doc = static_cast<uint32_t>(urls_.size());
+  urls_.push_back(url);
+
+  TermTokenizer::tokenize(text, terms_);
+  lengths_.push_back(static_cast<uint32_t>(terms_.size()));
+
+  order_.resize(terms_.size());
+  for (size_t i = 0; i < order_.size(); ++i)
+    order_[i] = static_cast<uint32_t>(i);
+  std::sort(order_.begin(), order_.end(), [this](uint32_t a, uint32_t b) {
+    int cmp = terms_[a].compare(terms_[b]);
+    return cmp < 0 || (cmp == 0 && a < b);
+  });
+
+  for (size_t i = 0; i < order_.size();) {
+    const std::string &term = terms_[order_[i]];
+    TermPostings &postings = postings_[term];
+    size_t j = i;
+    for (; j < order_.size() && terms_[order_[j]] == term; ++j)
+      postings.positions.push_back(order_[j]);
+    postings.postings.push_back(Posting{doc, static_cast<uint32_t>(j - i)});
+    i = j;
+  }
+
+  // Site terms sit at position 0; phrase queries never include them.
+  TermTokenizer::site_terms(url, terms_);
+  for (const auto &site : terms_) {
+    TermPostings &postings = postings_[site];
+    postings.positions.push_back(0);
+    postings.postings.push_back(Posting{doc, 1});
+  }
+
+  ++total_docs_;
+  if (urls_.size() >= segment_docs_)
+    return flush_segment();
+  return true;
+}
+
+static void pad_to(std::string &out, size_t alignment) {
+  out.resize((out.size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+void IndexBuilder::encode_postings(const TermPostings &term,
+                                   const std::vector<uint32_t> &lengths,
+                                   TermEntry &entry, std::string &out,
+                                   std::string &positions) {
+  const std::vector<Posting> &postings = term.postings;
+  const uint32_t *position = term.positions.data();
+  size_t positions_start = positions.size();
+  const size_t block_size = PostingsCodec::kBlockSize;
+  std::vector<SkipEntry> skips;
+  std::string blocks;
+  uint32_t gaps[PostingsCodec::kBlockSize];
+  uint32_t tfs[PostingsCodec::kBlockSize];
+  uint32_t previous = 0;
+  entry.max_tf = 0;
+  entry.min_length = UINT32_MAX;
+  for (size_t start = 0; start < postings.size(); start += block_size) {
+    size_t length = std::min(block_size, postings.size() - start);
+    SkipEntry skip = {
+        0, static_cast<uint32_t>(blocks.size()),
+        static_cast<uint32_t>(positions.size() - positions_start), 0,
+        UINT32_MAX};
+    for (size_t i = 0; i < length; ++i) {
+      const Posting &posting = postings[start + i];
+      gaps[i] = posting.doc - previous;
+      tfs[i] = posting.tf;
+      previous = posting.doc;
+      for (uint32_t k = 0, last = 0; k < posting.tf; ++k, ++position) {
+        PostingsCodec::put_varint(*position - last, positions);
+        last = *position;
+      }
+      skip.max_tf = std::max(skip.max_tf, posting.tf);
+      skip.min_length = std::min(skip.min_length, lengths[posting.doc]);
+    }
+    skip.last_doc = previous;
+    skips.push_back(skip);
+    entry.max_tf = std::max(entry.max_tf, skip.max_tf);
+    entry.min_length = std::min(entry.min_length, skip.min_length);
+
+    if (length == block_size) {
+      PostingsCodec::encode_block(gaps, blocks);
+      PostingsCodec::encode_block(tfs, blocks);
+    } else {
+      PostingsCodec::encode_varints(gaps, length, blocks);
+      PostingsCodec::encode_varints(tfs, length, blocks);
+    }
+  }
+
+  out.append(reinterpret_cast<const char *>(skips.data()),
+             skips.size() * sizeof(SkipEntry));
+  out += blocks;
+}
+
+bool IndexBuilder::flush_segment() {
+  if (urls_.empty())
+    return true;
+
+  char name[64];
+  snprintf(name, sizeof(name), "seg-%06llu-%05zu.idx",
+           static_cast<unsigned long long>(generation_), segments_.size());
+
+  std::vector<const std::pair<const std::string, TermPostings> *> terms;
+  terms.reserve(postings_.size());
+  for (const auto &entry : postings_)
+    terms.push_back(&entry);
+  std::sort(terms.begin(), terms.end(),
+            [](const auto *a, const auto *b) { return a->first < b->first; });
+
+  SegmentHeader header = {};
+  memcpy(header.magic, "WCIDXSEG", sizeof(header.magic));
+  header.version = kIndexFormatVersion;
+  header.block_size = PostingsCodec::kBlockSize;
+  header.doc_count = urls_.size();
+  header.term_count = terms.size();
+  for (uint32_t length : lengths_)
+    header.total_length += length;
+
+  std::string out(sizeof(SegmentHeader), '\0');
+  header.docs_offset = out.size();
+  uint64_t url_offset = 0;
+  for (size_t i = 0; i <= urls_.size(); ++i) {
+    out.append(reinterpret_cast<const char *>(&url_offset), sizeof(uint64_t));
+    if (i < urls_.size())
+      url_offset += urls_[i].size();
+  }
+  header.lengths_offset = out.size();
+  out.append(reinterpret_cast<const char *>(lengths_.data()),
+             lengths_.size() * sizeof(uint32_t));
+  for (const auto &url : urls_)
+    out += url;
+
+  pad_to(out, alignof(TermEntry));
+  header.terms_offset = out.size();
+  out.resize(out.size() + terms.size() * sizeof(TermEntry), '\0');
+
+  header.term_bytes_offset = out.size();
+  std::vector<TermEntry> entries(terms.size());
+  for (size_t i = 0; i < terms.size(); ++i) {
+    entries[i].term_offset = out.size() - header.term_bytes_offset;
+    entries[i].term_length = static_cast<uint32_t>(terms[i]->first.size());
+    entries[i].doc_freq =
+        static_cast<uint32_t>(terms[i]->second.postings.size());
+    out += terms[i]->first;
+  }
+
+  pad_to(out, alignof(SkipEntry));
+  header.postings_offset = out.size();
+  std::string positions;
+  for (size_t i = 0; i < terms.size(); ++i) {
+    pad_to(out, alignof(SkipEntry));
+    entries[i].postings_offset = out.size();
+    entries[i].positions_offset = positions.size();
+    encode_postings(terms[i]->second, lengths_, entries[i], out, positions);
+  }
+
+  header.positions_offset = out.size();
+  out += positions;
+  for (auto &entry : entries)
+    entry.positions_offset += header.positions_offset;
+
+  memcpy(&out[0], &header, sizeof(header));
+  memcpy(&out[header.terms_offset], entries.data(),
+         entries.size() * sizeof(TermEntry));
+
+  std::string path = dir_ + "/" + name;
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(out.data(), out.size());
+  file.close();
+  if (!file) {
+    std::cerr << "Failed to write index segment " << path << std::endl;
+    return false;
+  }
+
+  index_bytes_ += out.size();
+  segments_.push_back(name);
+  urls_.clear();
+  lengths_.clear();
+  postings_.clear();
+  return true;
+}
+
+bool IndexBuilder::finish() {
+  if (!flush_segment())
+    return false;
+
+  std::string manifest = dir_ + "/MANIFEST";
+  {
+    std::ofstream file(manifest + ".tmp", std::ios::trunc);
+    file << "format " << kIndexFormatVersion << "\n";
+    file << "generation " << generation_ << "\n";
+    for (const auto &segment : segments_)
+      file << "segment " << segment << "\n";
+    file.close();
+    if (!file) {
+      std::cerr << "Failed to write " << manifest << ".tmp" << std::endl;
+      return false;
+    }
+  }
+  if (std::rename((manifest + ".tmp").c_str(), manifest.c_str()) != 0) {
+    std::cerr << "Failed to publish " << manifest << std::endl;
+    return false;
+  }
+
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(dir_, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.rfind("seg-", 0) == 0 &&
+        std::find(segments_.begin(), segments_.end(), name) == segments_.end())
+      std::filesystem::remove(entry.path(), ec);
+  }
+  return true;
+}
\ No newline at end of file
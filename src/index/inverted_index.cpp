@@ -0,0 +1,574 @@
+#include "../../inc/inverted_index.h"
+#include "../../inc/query_plan.h"
+#include "../../inc/url_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char kSegmentMagic[8] = {'W', 'C', 'I', 'D', 'X', 'S', 'E', 'G'};
+
+void TermTokenizer::tokenize(const std::string &text,
+                             std::vector<std::string> &terms) {
+  terms.clear();
+  std::string term;
+  for (size_t i = 0; i <= text.size(); ++i) {
+    unsigned char c = i < text.size() ? text[i] : ' ';
+    if (std::isalnum(c) || c >= 0x80) {
+      term.push_back(static_cast<char>(std::tolower(c)));
+      continue;
+    }
+    if (!term.empty() && term.size() <= kMaxTermLength)
+      terms.push_back(term);
+    term.clear();
+  }
+}
+
+std::string TermTokenizer::site_term(const std::string &host) {
+  std::string term = "site:";
+  for (unsigned char c : host)
+    term.push_back(static_cast<char>(std::tolower(c)));
+  return term;
+}
+
+// The host of a page and each of its parent domains short of the top level:
+// a.example.com gives site:a.example.com and site:example.com.
+void TermTokenizer::site_terms(const std::string &url,
+                               std::vector<std::string> &terms) {
+  terms.clear();
+  std::string host = UrlUtils::extract_domain(url);
+  if (host.empty())
+    return;
+  terms.push_back(site_term(host));
+  for (size_t dot = host.find('.');
+       dot != std::string::npos && host.find('.', dot + 1) != std::string::npos;
+       dot = host.find('.', dot + 1))
+    terms.push_back(site_term(host.substr(dot + 1)));
+}
+
+IndexSegment::~IndexSegment() {
+  if (data_)
+    munmap(const_cast<uint8_t *>(data_), size_);
+}
+
+static bool fail(std::string *error, const std::string &message) {
+  if (error)
+    *error = message;
+  return false;
+}
+
+bool IndexSegment::open(const std::string &path, std::string *error) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return fail(error, "cannot open index segment " + path);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+    ::close(fd);
+    return fail(error, "truncated index segment " + path);
+  }
+  size_ = st.st_size;
+  void *mapped = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+    return fail(error, "cannot map index segment " + path);
+  data_ = static_cast<const uint8_t *>(mapped);
+
+  header_ = reinterpret_cast<const SegmentHeader *>(data_);
+  if (memcmp(header_->magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0)
+    return fail(error, path + " is not an index segment");
+  if (header_->version != kIndexFormatVersion ||
+      header_->block_size != PostingsCodec::kBlockSize)
+    return fail(error, path + " uses index format version " +
+                           std::to_string(header_->version) + ", expected " +
+                           std::to_string(kIndexFormatVersion) +
+                           "; rebuild it with ./indexer");
+  if (header_->docs_offset > size_ || header_->lengths_offset > size_ ||
+      header_->terms_offset > size_ ||
+      header_->term_bytes_offset > size_ || header_->postings_offset > size_ ||
+      header_->positions_offset > size_)
+    return fail(error, "corrupt index segment " + path);
+
+  url_offsets_ =
+      reinterpret_cast<const uint64_t *>(data_ + header_->docs_offset);
+  lengths_ =
+      reinterpret_cast<const uint32_t *>(data_ + header_->lengths_offset);
+  urls_ = reinterpret_cast<const char *>(lengths_ + header_->doc_count);
+  terms_ = reinterpret_cast<const TermEntry *>(data_ + header_->terms_offset);
+  term_bytes_ =
+      reinterpret_cast<const char *>(data_ + header_->term_bytes_offset);
+  madvise(mapped, size_, MADV_RANDOM);
+  return true;
+}
+
+std::string IndexSegment::url(uint32_t doc) const {
+  return std::string(urls_ + url_offsets_[doc],
+                     url_offsets_[doc + 1] - url_offsets_[doc]);
+}
+
+const TermEntry *IndexSegment::find(const std::string &term) const {
+  const TermEntry *begin = terms_;
+  const TermEntry *end = terms_ + header_->term_count;
+  const TermEntry *it = std::lower_bound(
+      begin, end, term, [this](const TermEntry &entry, const std::string &key) {
+        int cmp = memcmp(term_bytes_ + entry.term_offset, key.data(),
+                         std::min<size_t>(entry.term_length, key.size()));
+        return cmp < 0 || (cmp == 0 && entry.term_length < key.size());
+      });
+  if (it == end || it->term_length != term.size() ||
+      memcmp(term_bytes_ + it->term_offset, term.data(), term.size()) != 0)
+    return nullptr;
+  return it;
+}
+
+PostingCursor::PostingCursor(const IndexSegment &segment,
+                             const TermEntry &entry)
+    : entry_(&entry) {
+  block_count_ = (entry.doc_freq + PostingsCodec::kBlockSize - 1) /
+                 PostingsCodec::kBlockSize;
+  skips_ = reinterpret_cast<const SkipEntry *>(segment.postings(entry));
+  blocks_ = reinterpret_cast<const uint8_t *>(skips_ + block_count_);
+  positions_ = segment.positions(entry);
+  load_block(0);
+}
+
+void PostingCursor::load_block(size_t block) {
+  block_ = block;
+  position_ = 0;
+  freqs_decoded_ = false;
+  if (block >= block_count_) {
+    doc_ = kEnd;
+    return;
+  }
+
+  const uint8_t *in = blocks_ + skip(block).block_offset;
+  position_data_ = positions_ + skip(block).positions_offset;
+  positions_read_ = 0;
+  block_length_ = block + 1 < block_count_
+                      ? PostingsCodec::kBlockSize
+                      : entry_->doc_freq - block * PostingsCodec::kBlockSize;
+  if (block_length_ == PostingsCodec::kBlockSize)
+    freqs_ = PostingsCodec::decode_block(in, docs_);
+  else
+    freqs_ = PostingsCodec::decode_varints(in, block_length_, docs_);
+  decoded_ += block_length_;
+
+  uint32_t doc = block ? skip(block - 1).last_doc : 0;
+  for (size_t i = 0; i < block_length_; ++i) {
+    doc += docs_[i];
+    docs_[i] = doc;
+  }
+  doc_ = docs_[0];
+}
+
+uint32_t PostingCursor::freq() {
+  if (!freqs_decoded_) {
+    if (block_length_ == PostingsCodec::kBlockSize)
+      PostingsCodec::decode_block(freqs_, tfs_);
+    else
+      PostingsCodec::decode_varints(freqs_, block_length_, tfs_);
+    freqs_decoded_ = true;
+  }
+  return tfs_[position_];
+}
+
+void PostingCursor::positions(std::vector<uint32_t> &out) {
+  freq();
+  if (positions_read_ > position_) {
+    position_data_ = current_positions_;
+    positions_read_ = position_;
+  }
+  for (; positions_read_ < position_; ++positions_read_) {
+    for (uint32_t n = tfs_[positions_read_]; n; ++position_data_)
+      n -= !(*position_data_ & 0x80);
+  }
+
+  current_positions_ = position_data_;
+  out.resize(tfs_[position_]);
+  uint32_t position = 0;
+  for (auto &value : out) {
+    uint32_t delta;
+    position_data_ = PostingsCodec::get_varint(position_data_, delta);
+    value = position += delta;
+  }
+  ++positions_read_;
+}
+
+uint32_t PostingCursor::next() {
+  if (doc_ == kEnd)
+    return doc_;
+  if (++position_ < block_length_)
+    return doc_ = docs_[position_];
+  load_block(block_ + 1);
+  return doc_;
+}
+
+// Gallops forward from the current block, so seeking a short list's next
+// doc in a long list costs the log of the distance, not of the list.
+uint32_t PostingCursor::shallow_seek(uint32_t target) {
+  size_t low = block_;
+  size_t high = block_count_;
+  if (low < high && skip(low).last_doc < target) {
+    size_t step = 1;
+    while (low + step < high && skip(low + step).last_doc < target) {
+      low += step;
+      step *= 2;
+    }
+    high = std::min(high, low + step);
+    ++low;
+    while (low < high) {
+      size_t mid = (low + high) / 2;
+      if (skip(mid).last_doc < target)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+  }
+  shallow_ = low;
+  return low < block_count_ ? skip(low).last_doc : kEnd;
+}
+
+uint32_t PostingCursor::next_geq(uint32_t target) {
+  if (doc_ >= target)
+    return doc_;
+  shallow_seek(target);
+  if (shallow_ != block_)
+    load_block(shallow_);
+  if (doc_ < target) {
+    position_ = std::lower_bound(docs_ + position_, docs_ + block_length_,
+                                 target) -
+                docs_;
+    doc_ = docs_[position_];
+  }
+  return doc_;
+}
+
+bool InvertedIndex::read_manifest(const std::string &dir, uint64_t &generation,
+                                  std::vector<std::string> &segments,
+                                  std::string *error) {
+  std::ifstream manifest(dir + "/MANIFEST");
+  if (!manifest.is_open())
+    return fail(error, "no index manifest in " + dir);
+
+  std::string line;
+  uint32_t version = 0;
+  segments.clear();
+  while (std::getline(manifest, line)) {
+    std::istringstream fields(line);
+    std::string key;
+    fields >> key;
+    if (key == "format") {
+      fields >> version;
+    } else if (key == "generation") {
+      fields >> generation;
+    } else if (key == "segment") {
+      std::string name;
+      if (fields >> name)
+        segments.push_back(name);
+    }
+  }
+  if (version != kIndexFormatVersion)
+    return fail(error, "index in " + dir + " uses format version " +
+                           std::to_string(version) + ", expected " +
+                           std::to_string(kIndexFormatVersion) +
+                           "; rebuild it with ./indexer");
+  return true;
+}
+
+bool InvertedIndex::open(const std::string &dir, std::string *error) {
+  std::vector<std::string> names;
+  if (!read_manifest(dir, generation_, names, error))
+    return false;
+
+  segments_.clear();
+  for (const auto &name : names) {
+    auto segment = std::make_unique<IndexSegment>();
+    if (!segment->open(dir + "/" + name, error))
+      return false;
+    segments_.push_back(std::move(segment));
+  }
+
+  uint64_t total_length = 0;
+  doc_count_ = 0;
+  for (const auto &segment : segments_) {
+    doc_count_ += segment->doc_count();
+    total_length += segment->total_length();
+  }
+  avg_length_ = doc_count_ ? static_cast<double>(total_length) / doc_count_
+                           : 0;
+  return true;
+}
+
+namespace {
+
+struct ScoredTerm {
+  PostingCursor cursor;
+  double idf;
+  double max_score;
+};
+
+bool better(const IndexHit &a, const IndexHit &b) {
+  if (a.score != b.score)
+    return a.score > b.score;
+  if (a.segment != b.segment)
+    return a.segment < b.segment;
+  return a.doc < b.doc;
+}
+
+// Bounded heap whose front is the worst of the best `limit` hits so far.
+class TopK {
+public:
+  explicit TopK(size_t limit) : limit_(limit) {}
+
+  double threshold() const {
+    return hits_.size() < limit_ ? 0 : hits_.front().score;
+  }
+
+  void push(const IndexHit &hit) {
+    if (hits_.size() < limit_) {
+      hits_.push_back(hit);
+      std::push_heap(hits_.begin(), hits_.end(), better);
+    } else if (better(hit, hits_.front())) {
+      std::pop_heap(hits_.begin(), hits_.end(), better);
+      hits_.back() = hit;
+      std::push_heap(hits_.begin(), hits_.end(), better);
+    }
+  }
+
+  std::vector<IndexHit> take() {
+    std::sort_heap(hits_.begin(), hits_.end(), better);
+    return std::move(hits_);
+  }
+
+private:
+  size_t limit_;
+  std::vector<IndexHit> hits_;
+};
+
+} // namespace
+
+std::vector<std::string> IndexQuery::terms_used() const {
+  std::vector<std::string> words;
+  if (kind == PHRASE)
+    words = terms;
+  for (const auto &child : children) {
+    std::vector<std::string> child_words = child.terms_used();
+    words.insert(words.end(), child_words.begin(), child_words.end());
+  }
+  std::sort(words.begin(), words.end());
+  words.erase(std::unique(words.begin(), words.end()), words.end());
+  return words;
+}
+
+std::string IndexQuery::to_string() const {
+  std::string text;
+  switch (kind) {
+  case PHRASE:
+    for (const auto &term : terms)
+      text += (text.empty() ? "\"" : " ") + term;
+    return text + "\"";
+  case SITE:
+    return "site:" + (terms.empty() ? "" : terms[0]);
+  case NEAR:
+    for (const auto &child : children)
+      text += (text.empty() ? "NEAR(" : " ") + child.to_string();
+    return text + ", " + std::to_string(distance) + ")";
+  case NOT:
+    return "NOT " + (children.empty() ? "()" : children[0].to_string());
+  case AND:
+  case OR:
+    for (const auto &child : children)
+      text += (text.empty() ? "(" : kind == AND ? " AND " : " OR ") +
+              child.to_string();
+    return text.empty() ? "()" : text + ")";
+  }
+  return text;
+}
+
+// Scores every match of the plan unless the block bounds of its terms show
+// it cannot beat the current top-k threshold, and only checks positions of
+// candidates that pass the bound. A bound holds up to the end of the first
+// block it was taken from, and is reused until then.
+static void search_plan(QueryIterator &root, size_t segment_id, TopK &top,
+                        IndexQueryStats &stats) {
+  double bound = 0;
+  uint32_t block_end = 0;
+  bool bounded = false;
+  uint32_t target = 0;
+  for (;;) {
+    double threshold = top.threshold();
+    if (threshold > 0) {
+      if (!bounded || target > block_end) {
+        if (!root.block_bound(target, bound, block_end))
+          return;
+        bounded = true;
+      }
+      if (bound <= threshold) {
+        if (block_end == PostingCursor::kEnd)
+          return;
+        target = block_end + 1;
+        continue;
+      }
+    }
+
+    uint32_t doc = root.next_geq(target);
+    if (doc == PostingCursor::kEnd)
+      return;
+    if (threshold > 0 && doc > block_end) {
+      target = doc;
+      continue;
+    }
+    if (!root.matches()) {
+      target = doc + 1;
+      continue;
+    }
+    ++stats.scored;
+    top.push(IndexHit{segment_id, doc, root.score()});
+    target = doc + 1;
+  }
+}
+
+// Block-max WAND: terms are kept ordered by current doc, the pivot is the
+// first doc whose term upper bounds could beat the threshold, and the block
+// bounds around the pivot decide whether to score it or skip past the
+// blocks entirely.
+static void search_any_term(const IndexSegment &segment, size_t segment_id,
+                            std::vector<ScoredTerm> &terms, double avg_length,
+                            TopK &top, IndexQueryStats &stats) {
+  std::vector<ScoredTerm *> live;
+  for (auto &term : terms)
+    live.push_back(&term);
+
+  for (;;) {
+    live.erase(std::remove_if(live.begin(), live.end(),
+                              [](ScoredTerm *term) {
+                                return term->cursor.doc() ==
+                                       PostingCursor::kEnd;
+                              }),
+               live.end());
+    std::sort(live.begin(), live.end(), [](ScoredTerm *a, ScoredTerm *b) {
+      return a->cursor.doc() < b->cursor.doc();
+    });
+
+    double threshold = top.threshold();
+    double upper = 0;
+    size_t pivot = 0;
+    while (pivot < live.size() &&
+           (upper += live[pivot]->max_score) <= threshold)
+      ++pivot;
+    if (pivot == live.size())
+      return;
+    uint32_t pivot_doc = live[pivot]->cursor.doc();
+    while (pivot + 1 < live.size() &&
+           live[pivot + 1]->cursor.doc() == pivot_doc)
+      ++pivot;
+
+    double bound = 0;
+    uint32_t block_end = PostingCursor::kEnd;
+    for (size_t i = 0; i <= pivot; ++i) {
+      uint32_t last = live[i]->cursor.shallow_seek(pivot_doc);
+      if (last == PostingCursor::kEnd)
+        continue;
+      const SkipEntry &block = live[i]->cursor.shallow_block();
+      bound += bm25_score(live[i]->idf, block.max_tf, block.min_length,
+                          avg_length);
+      block_end = std::min(block_end, last);
+    }
+
+    if (bound > threshold) {
+      if (live[0]->cursor.doc() == pivot_doc) {
+        double score = 0;
+        uint32_t length = segment.doc_length(pivot_doc);
+        for (size_t i = 0; i <= pivot; ++i) {
+          score += bm25_score(live[i]->idf, live[i]->cursor.freq(), length,
+                        avg_length);
+          live[i]->cursor.next();
+        }
+        ++stats.scored;
+        top.push(IndexHit{segment_id, pivot_doc, score});
+      } else {
+        for (size_t i = 0; i < pivot; ++i)
+          live[i]->cursor.next_geq(pivot_doc);
+      }
+      continue;
+    }
+
+    uint32_t next = block_end == PostingCursor::kEnd ? block_end
+                                                     : block_end + 1;
+    if (pivot + 1 < live.size())
+      next = std::min(next, live[pivot + 1]->cursor.doc());
+    if (next <= pivot_doc)
+      next = pivot_doc + 1;
+    for (size_t i = 0; i <= pivot; ++i)
+      live[i]->cursor.next_geq(next);
+  }
+}
+
+std::vector<IndexHit> InvertedIndex::search(const IndexQuery &query,
+                                            size_t limit,
+                                            IndexQueryStats *stats) const {
+  TopK top(limit);
+  IndexQueryStats local;
+  if (query.empty() || limit == 0 || doc_count_ == 0)
+    return top.take();
+
+  std::map<std::string, double> idf;
+  for (const auto &term : query.terms_used()) {
+    size_t doc_freq = 0;
+    for (const auto &segment : segments_) {
+      const TermEntry *entry = segment->find(term);
+      if (entry)
+        doc_freq += entry->doc_freq;
+    }
+    idf[term] = std::log(1 + (doc_count_ - doc_freq + 0.5) / (doc_freq + 0.5));
+  }
+
+  // A plain OR of words runs as block-max WAND, which also skips documents
+  // that only contain low-scoring words; anything else runs as a plan.
+  bool any_word = query.kind == IndexQuery::OR;
+  for (const auto &child : query.children)
+    any_word = any_word && child.kind == IndexQuery::PHRASE &&
+               child.terms.size() == 1;
+
+  for (size_t s = 0; s < segments_.size(); ++s) {
+    if (!any_word) {
+      QueryPlanner planner(*segments_[s], idf, avg_length_, local);
+      std::unique_ptr<QueryIterator> root = planner.plan(query);
+      if (root)
+        search_plan(*root, s, top, local);
+      local.decoded += planner.decoded();
+      continue;
+    }
+
+    std::vector<ScoredTerm> scored;
+    for (const auto &child : query.children) {
+      const TermEntry *entry = segments_[s]->find(child.terms[0]);
+      if (!entry)
+        continue;
+      double weight = idf[child.terms[0]];
+      scored.push_back(ScoredTerm{PostingCursor(*segments_[s], *entry), weight,
+                                  bm25_score(weight, entry->max_tf,
+                                             entry->min_length, avg_length_)});
+      local.postings += entry->doc_freq;
+    }
+    search_any_term(*segments_[s], s, scored, avg_length_, top, local);
+    for (const auto &term : scored)
+      local.decoded += term.cursor.decoded();
+  }
+
+  if (stats)
+    *stats = local;
+  return top.take();
+}
+
+std::string InvertedIndex::url(const IndexHit &hit) const {
+  return segments_[hit.segment]->url(hit.doc);
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "../../inc/postings_codec.h"
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Full blocks use a SIMD-BP128 style vertical layout: value k lives in lane
+// k % 4 of consecutive 128-bit words, so four values unpack per instruction.
+// Values wider than the chosen bit width are patched from an exception list
+// (PFor).
+
+static const size_t kLanes = 4;
+static const size_t kSlots = PostingsCodec::kBlockSize / kLanes;
+
+static unsigned bits_needed(uint32_t value) {
+  return value ? 32 - __builtin_clz(value) : 0;
+}
+
+static size_t varint_size(uint32_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+void PostingsCodec::put_varint(uint32_t value, std::string &out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+const uint8_t *PostingsCodec::get_varint(const uint8_t *in, uint32_t &value) {
+  value = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    uint8_t byte = *in++;
+    value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return in;
+  }
+}
+
+void PostingsCodec::encode_varints(const uint32_t *values, size_t count,
+                                   std::string &out) {
+  for (size_t i = 0; i < count; ++i)
+    put_varint(values[i], out);
+}
+
+const uint8_t *PostingsCodec::decode_varints(const uint8_t *in, size_t count,
+                                             uint32_t *values) {
+  for (size_t i = 0; i < count; ++i)
+    in = get_varint(in, values[i]);
+  return in;
+}
+
+void PostingsCodec::encode_block(const uint32_t *values, std::string &out) {
+  size_t best_bits = 32;
+  size_t best_size = 16 * 32;
+  for (unsigned bits = 0; bits < 32; ++bits) {
+    size_t size = 16 * bits;
+    size_t exceptions = 0;
+    for (size_t i = 0; i < kBlockSize && size < best_size; ++i) {
+      if (bits_needed(values[i]) > bits) {
+        size += 1 + varint_size(values[i] >> bits);
+        ++exceptions;
+      }
+    }
+    if (exceptions < 256 && size < best_size) {
+      best_size = size;
+      best_bits = bits;
+    }
+  }
+
+  uint32_t packed[kBlockSize] = {};
+  std::string positions;
+  std::string high;
+  uint32_t mask = best_bits == 32 ? ~0u : (1u << best_bits) - 1;
+  for (size_t k = 0; k < kBlockSize; ++k) {
+    uint32_t value = values[k];
+    if (best_bits < 32 && (value >> best_bits)) {
+      positions.push_back(static_cast<char>(k));
+      put_varint(value >> best_bits, high);
+    }
+    value &= mask;
+
+    size_t lane = k % kLanes;
+    size_t offset = (k / kLanes) * best_bits;
+    size_t word = offset / 32;
+    size_t shift = offset % 32;
+    packed[word * kLanes + lane] |= value << shift;
+    if (shift + best_bits > 32)
+      packed[(word + 1) * kLanes + lane] |= value >> (32 - shift);
+  }
+
+  out.push_back(static_cast<char>(best_bits));
+  out.push_back(static_cast<char>(positions.size()));
+  out.append(reinterpret_cast<const char *>(packed), 16 * best_bits);
+  out += positions;
+  out += high;
+}
+
+const uint8_t *PostingsCodec::decode_block(const uint8_t *in,
+                                           uint32_t *values) {
+  unsigned bits = in[0];
+  size_t exceptions = in[1];
+  const uint8_t *packed = in + 2;
+
+  if (bits == 0) {
+    memset(values, 0, kBlockSize * sizeof(uint32_t));
+  } else {
+#if defined(__SSE2__)
+    const __m128i *words = reinterpret_cast<const __m128i *>(packed);
+    __m128i mask = _mm_set1_epi32(bits == 32 ? ~0u : (1u << bits) - 1);
+    __m128i *out = reinterpret_cast<__m128i *>(values);
+    for (size_t slot = 0; slot < kSlots; ++slot) {
+      size_t offset = slot * bits;
+      size_t word = offset / 32;
+      size_t shift = offset % 32;
+      __m128i value = _mm_srl_epi32(_mm_loadu_si128(words + word),
+                                    _mm_cvtsi32_si128(shift));
+      if (shift + bits > 32) {
+        value = _mm_or_si128(value,
+                             _mm_sll_epi32(_mm_loadu_si128(words + word + 1),
+                                           _mm_cvtsi32_si128(32 - shift)));
+      }
+      _mm_storeu_si128(out + slot, _mm_and_si128(value, mask));
+    }
+#else
+    uint32_t words[kBlockSize];
+    memcpy(words, packed, 16 * bits);
+    uint32_t mask = bits == 32 ? ~0u : (1u << bits) - 1;
+    for (size_t slot = 0; slot < kSlots; ++slot) {
+      size_t offset = slot * bits;
+      size_t word = offset / 32;
+      size_t shift = offset % 32;
+      for (size_t lane = 0; lane < kLanes; ++lane) {
+        uint64_t value = words[word * kLanes + lane] >> shift;
+        if (shift + bits > 32)
+          value |= static_cast<uint64_t>(words[(word + 1) * kLanes + lane])
+                   << (32 - shift);
+        values[slot * kLanes + lane] = static_cast<uint32_t>(value) & mask;
+      }
+    }
+#endif
+  }
+
+  const uint8_t *positions = packed + 16 * bits;
+  const uint8_t *high = positions + exceptions;
+  for (size_t i = 0; i < exceptions; ++i) {
+    uint32_t value;
+    high = get_varint(high, value);
+    values[positions[i]] |= value << bits;
+  }
+  return high;
+}
\ No newline at end of file
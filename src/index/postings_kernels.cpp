@@ -0,0 +1,583 @@
+#include "../../inc/postings_kernels.h"
+#include <algorithm>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POSTINGS_KERNELS_X86 1
+#endif
+
+// Lane selections that move the lanes set in a mask to the front, as byte
+// shuffles for 4-lane vectors and as lane permutations for 8-lane ones.
+struct CompactTables {
+  alignas(16) uint8_t bytes[16][16];
+  alignas(32) uint32_t lanes[256][8];
+
+  CompactTables() : bytes(), lanes() {
+    for (int mask = 0; mask < 16; ++mask) {
+      int count = 0;
+      for (int lane = 0; lane < 4; ++lane) {
+        if (!(mask & 1 << lane))
+          continue;
+        for (int byte = 0; byte < 4; ++byte)
+          bytes[mask][count * 4 + byte] = static_cast<uint8_t>(lane * 4 + byte);
+        ++count;
+      }
+    }
+    for (int mask = 0; mask < 256; ++mask) {
+      int count = 0;
+      for (int lane = 0; lane < 8; ++lane) {
+        if (mask & 1 << lane)
+          lanes[mask][count++] = lane;
+      }
+    }
+  }
+};
+
+static const CompactTables compact;
+
+static size_t intersect_merge(const uint32_t *a, size_t a_size,
+                              const uint32_t *b, size_t b_size,
+                              uint32_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  while (i < a_size && j < b_size) {
+    if (a[i] < b[j]) {
+      ++i;
+    } else if (b[j] < a[i]) {
+      ++j;
+    } else {
+      out[count++] = a[i];
+      ++i;
+      ++j;
+    }
+  }
+  return count;
+}
+
+// rare must be the shorter list here and in the V1 and V3 kernels.
+static size_t intersect_gallop(const uint32_t *rare, size_t rare_size,
+                               const uint32_t *freq, size_t freq_size,
+                               uint32_t *out) {
+  size_t j = 0, count = 0;
+  for (size_t i = 0; i < rare_size && j < freq_size; ++i) {
+    uint32_t doc = rare[i];
+    if (freq[j] < doc) {
+      size_t low = j, step = 1;
+      while (low + step < freq_size && freq[low + step] < doc) {
+        low += step;
+        step *= 2;
+      }
+      j = std::lower_bound(freq + low + 1,
+                           freq + std::min(low + step + 1, freq_size), doc) -
+          freq;
+      if (j == freq_size)
+        break;
+    }
+    if (freq[j] == doc)
+      out[count++] = doc;
+  }
+  return count;
+}
+
+static size_t unite_merge(const uint32_t *a, size_t a_size, const uint32_t *b,
+                          size_t b_size, uint32_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  while (i < a_size && j < b_size) {
+    uint32_t x = a[i], y = b[j];
+    out[count++] = std::min(x, y);
+    i += x <= y;
+    j += y <= x;
+  }
+  out = std::copy(a + i, a + a_size, out + count);
+  std::copy(b + j, b + b_size, out);
+  return count + (a_size - i) + (b_size - j);
+}
+
+// Merges what a vector union left over into out, which already holds count
+// docs: the sorted lanes of its last merge and the tails of both lists. None
+// is smaller than the docs in out, but the first may repeat the last of them.
+static size_t finish_union(const uint32_t *pending, size_t pending_size,
+                           const uint32_t *a, size_t a_size, const uint32_t *b,
+                           size_t b_size, uint32_t *out, size_t count) {
+  size_t p = 0, i = 0, j = 0;
+  for (;;) {
+    const uint32_t *next = p < pending_size ? pending + p : nullptr;
+    if (i < a_size && (!next || a[i] < *next))
+      next = a + i;
+    if (j < b_size && (!next || b[j] < *next))
+      next = b + j;
+    if (!next)
+      break;
+    if (next == pending + p)
+      ++p;
+    else if (next == a + i)
+      ++i;
+    else
+      ++j;
+    if (out[count - 1] != *next)
+      out[count++] = *next;
+  }
+  return count;
+}
+
+#ifdef POSTINGS_KERNELS_X86
+static inline const __m128i *vec128(const void *p) {
+  return static_cast<const __m128i *>(p);
+}
+
+static inline const __m256i *vec256(const void *p) {
+  return static_cast<const __m256i *>(p);
+}
+
+// Lanes of a equal to any lane of b.
+__attribute__((target("sse4.1"))) static inline __m128i
+rotation_hits(__m128i a, __m128i b) {
+  __m128i hits = _mm_cmpeq_epi32(a, b);
+  hits = _mm_or_si128(hits, _mm_cmpeq_epi32(a, _mm_shuffle_epi32(b, 0x39)));
+  hits = _mm_or_si128(hits, _mm_cmpeq_epi32(a, _mm_shuffle_epi32(b, 0x4e)));
+  return _mm_or_si128(hits, _mm_cmpeq_epi32(a, _mm_shuffle_epi32(b, 0x93)));
+}
+
+// Compares four docs of each list against every rotation of the other four
+// and keeps the hits of a, advancing whichever block ends first.
+__attribute__((target("sse4.1"))) static size_t
+intersect_shuffle_sse(const uint32_t *a, size_t a_size, const uint32_t *b,
+                      size_t b_size, uint32_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  size_t a_end = a_size & ~size_t(3), b_end = b_size & ~size_t(3);
+  while (i < a_end && j < b_end) {
+    __m128i va = _mm_loadu_si128(vec128(a + i));
+    __m128i vb = _mm_loadu_si128(vec128(b + j));
+    __m128i hits = rotation_hits(va, vb);
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(hits));
+    __m128i shuffle = _mm_load_si128(vec128(compact.bytes[mask]));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + count),
+                     _mm_shuffle_epi8(va, shuffle));
+    count += __builtin_popcount(mask);
+
+    uint32_t a_last = a[i + 3], b_last = b[j + 3];
+    i += a_last <= b_last ? 4 : 0;
+    j += b_last <= a_last ? 4 : 0;
+  }
+  return count + intersect_merge(a + i, a_size - i, b + j, b_size - j,
+                                 out + count);
+}
+
+// Skips the longer list eight docs at a time, then compares the doc of the
+// shorter one against all eight.
+__attribute__((target("sse4.1"))) static size_t
+intersect_v1_sse(const uint32_t *rare, size_t rare_size, const uint32_t *freq,
+                 size_t freq_size, uint32_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  for (; i < rare_size; ++i) {
+    uint32_t doc = rare[i];
+    while (j + 8 <= freq_size && freq[j + 7] < doc)
+      j += 8;
+    if (j + 8 > freq_size)
+      break;
+    __m128i needle = _mm_set1_epi32(static_cast<int>(doc));
+    __m128i hits =
+        _mm_or_si128(_mm_cmpeq_epi32(needle, _mm_loadu_si128(vec128(freq + j))),
+                     _mm_cmpeq_epi32(needle,
+                                     _mm_loadu_si128(vec128(freq + j + 4))));
+    out[count] = doc;
+    count += !_mm_testz_si128(hits, hits);
+  }
+  return count + intersect_merge(rare + i, rare_size - i, freq + j,
+                                 freq_size - j, out + count);
+}
+
+// Like V1 over blocks of 32, narrowed to the half that can hold the doc.
+__attribute__((target("sse4.1"))) static size_t
+intersect_v3_sse(const uint32_t *rare, size_t rare_size, const uint32_t *freq,
+                 size_t freq_size, uint32_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  for (; i < rare_size; ++i) {
+    uint32_t doc = rare[i];
+    while (j + 32 <= freq_size && freq[j + 31] < doc)
+      j += 32;
+    if (j + 32 > freq_size)
+      break;
+    const uint32_t *half = freq + j + (freq[j + 15] < doc ? 16 : 0);
+    __m128i needle = _mm_set1_epi32(static_cast<int>(doc));
+    __m128i hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi32(needle, _mm_loadu_si128(vec128(half))),
+                     _mm_cmpeq_epi32(needle,
+                                     _mm_loadu_si128(vec128(half + 4)))),
+        _mm_or_si128(
+            _mm_cmpeq_epi32(needle, _mm_loadu_si128(vec128(half + 8))),
+            _mm_cmpeq_epi32(needle, _mm_loadu_si128(vec128(half + 12)))));
+    out[count] = doc;
+    count += !_mm_testz_si128(hits, hits);
+  }
+  return count + intersect_gallop(rare + i, rare_size - i, freq + j,
+                                  freq_size - j, out + count);
+}
+
+// Sorts the eight lanes of a and b across low and high.
+__attribute__((target("sse4.1"))) static inline void
+merge_network(__m128i a, __m128i b, __m128i &low, __m128i &high) {
+  __m128i min = _mm_min_epu32(a, b);
+  __m128i max = _mm_max_epu32(a, b);
+  for (int round = 0; round < 3; ++round) {
+    __m128i rotated = _mm_alignr_epi8(min, min, 4);
+    min = _mm_min_epu32(rotated, max);
+    max = _mm_max_epu32(rotated, max);
+  }
+  low = _mm_alignr_epi8(min, min, 4);
+  high = max;
+}
+
+// Stores the sorted lanes of values that differ from the lane before them.
+__attribute__((target("sse4.1"))) static inline size_t
+store_unique(__m128i last, __m128i values, uint32_t *out) {
+  __m128i previous = _mm_alignr_epi8(values, last, 12);
+  int repeated =
+      _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(previous, values)));
+  int keep = ~repeated & 15;
+  __m128i shuffle = _mm_load_si128(vec128(compact.bytes[keep]));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                   _mm_shuffle_epi8(values, shuffle));
+  return __builtin_popcount(keep);
+}
+
+// Merges four docs at a time from whichever list has the smaller next doc,
+// keeping the larger half of each merge for the next one.
+__attribute__((target("sse4.1"))) static size_t
+unite_sse(const uint32_t *a, size_t a_size, const uint32_t *b, size_t b_size,
+          uint32_t *out) {
+  if (a_size < 4 || b_size < 4)
+    return unite_merge(a, a_size, b, b_size, out);
+
+  size_t a_end = a_size & ~size_t(3), b_end = b_size & ~size_t(3);
+  __m128i low, high;
+  merge_network(_mm_loadu_si128(vec128(a)), _mm_loadu_si128(vec128(b)), low,
+                high);
+  size_t count = store_unique(_mm_set1_epi32(-1), low, out);
+  __m128i last = low;
+  size_t i = 4, j = 4;
+  while (i < a_end && j < b_end) {
+    bool from_a = a[i] <= b[j];
+    __m128i next = _mm_loadu_si128(vec128(from_a ? a + i : b + j));
+    i += from_a ? 4 : 0;
+    j += from_a ? 0 : 4;
+    merge_network(next, high, low, high);
+    count += store_unique(last, low, out + count);
+    last = low;
+  }
+
+  uint32_t pending[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(pending), high);
+  return finish_union(pending, 4, a + i, a_size - i, b + j, b_size - j, out,
+                      count);
+}
+
+// Lanes of a equal to a lane of b in the same 128-bit half.
+__attribute__((target("avx2"))) static inline __m256i
+rotation_hits(__m256i a, __m256i b) {
+  __m256i hits = _mm256_cmpeq_epi32(a, b);
+  hits = _mm256_or_si256(hits,
+                         _mm256_cmpeq_epi32(a, _mm256_shuffle_epi32(b, 0x39)));
+  hits = _mm256_or_si256(hits,
+                         _mm256_cmpeq_epi32(a, _mm256_shuffle_epi32(b, 0x4e)));
+  return _mm256_or_si256(hits,
+                         _mm256_cmpeq_epi32(a, _mm256_shuffle_epi32(b, 0x93)));
+}
+
+// The 8-lane form of the SSE kernel: the in-half rotations of b and of b
+// with its halves swapped cover every pair.
+__attribute__((target("avx2"))) static size_t
+intersect_shuffle_avx2(const uint32_t *a, size_t a_size, const uint32_t *b,
+                       size_t b_size, uint32_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  size_t a_end = a_size & ~size_t(7), b_end = b_size & ~size_t(7);
+  while (i < a_end && j < b_end) {
+    __m256i va = _mm256_loadu_si256(vec256(a + i));
+    __m256i vb = _mm256_loadu_si256(vec256(b + j));
+    __m256i swapped = _mm256_permute2x128_si256(vb, vb, 1);
+    __m256i hits =
+        _mm256_or_si256(rotation_hits(va, vb), rotation_hits(va, swapped));
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(hits));
+    __m256i lanes = _mm256_load_si256(vec256(compact.lanes[mask]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + count),
+                        _mm256_permutevar8x32_epi32(va, lanes));
+    count += __builtin_popcount(mask);
+
+    uint32_t a_last = a[i + 7], b_last = b[j + 7];
+    i += a_last <= b_last ? 8 : 0;
+    j += b_last <= a_last ? 8 : 0;
+  }
+  return count + intersect_shuffle_sse(a + i, a_size - i, b + j, b_size - j,
+                                       out + count);
+}
+
+__attribute__((target("avx2"))) static size_t
+intersect_v1_avx2(const uint32_t *rare, size_t rare_size, const uint32_t *freq,
+                  size_t freq_size, uint32_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  for (; i < rare_size; ++i) {
+    uint32_t doc = rare[i];
+    while (j + 16 <= freq_size && freq[j + 15] < doc)
+      j += 16;
+    if (j + 16 > freq_size)
+      break;
+    __m256i needle = _mm256_set1_epi32(static_cast<int>(doc));
+    __m256i hits = _mm256_or_si256(
+        _mm256_cmpeq_epi32(needle, _mm256_loadu_si256(vec256(freq + j))),
+        _mm256_cmpeq_epi32(needle, _mm256_loadu_si256(vec256(freq + j + 8))));
+    out[count] = doc;
+    count += !_mm256_testz_si256(hits, hits);
+  }
+  return count + intersect_v1_sse(rare + i, rare_size - i, freq + j,
+                                  freq_size - j, out + count);
+}
+
+__attribute__((target("avx2"))) static size_t
+intersect_v3_avx2(const uint32_t *rare, size_t rare_size, const uint32_t *freq,
+                  size_t freq_size, uint32_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  for (; i < rare_size; ++i) {
+    uint32_t doc = rare[i];
+    while (j + 64 <= freq_size && freq[j + 63] < doc)
+      j += 64;
+    if (j + 64 > freq_size)
+      break;
+    const uint32_t *half = freq + j + (freq[j + 31] < doc ? 32 : 0);
+    __m256i needle = _mm256_set1_epi32(static_cast<int>(doc));
+    __m256i hits = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi32(needle, _mm256_loadu_si256(vec256(half))),
+            _mm256_cmpeq_epi32(needle, _mm256_loadu_si256(vec256(half + 8)))),
+        _mm256_or_si256(
+            _mm256_cmpeq_epi32(needle, _mm256_loadu_si256(vec256(half + 16))),
+            _mm256_cmpeq_epi32(needle,
+                               _mm256_loadu_si256(vec256(half + 24)))));
+    out[count] = doc;
+    count += !_mm256_testz_si256(hits, hits);
+  }
+  return count + intersect_v3_sse(rare + i, rare_size - i, freq + j,
+                                  freq_size - j, out + count);
+}
+
+// Sorts one bitonic vector: compare-exchanges lanes 4, 2 and then 1 apart.
+__attribute__((target("avx2"))) static inline __m256i
+bitonic_sort(__m256i v) {
+  __m256i t = _mm256_permute2x128_si256(v, v, 1);
+  v = _mm256_blend_epi32(_mm256_min_epu32(v, t), _mm256_max_epu32(v, t), 0xf0);
+  t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+  v = _mm256_blend_epi32(_mm256_min_epu32(v, t), _mm256_max_epu32(v, t), 0xcc);
+  t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+  return _mm256_blend_epi32(_mm256_min_epu32(v, t), _mm256_max_epu32(v, t),
+                            0xaa);
+}
+
+// Sorts the sixteen lanes of a and b across low and high.
+__attribute__((target("avx2"))) static inline void
+merge_network(__m256i a, __m256i b, __m256i &low, __m256i &high) {
+  __m256i reversed =
+      _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+  low = bitonic_sort(_mm256_min_epu32(a, reversed));
+  high = bitonic_sort(_mm256_max_epu32(a, reversed));
+}
+
+__attribute__((target("avx2"))) static inline size_t
+store_unique(__m256i last, __m256i values, uint32_t *out) {
+  __m256i back = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+  __m256i previous =
+      _mm256_blend_epi32(_mm256_permutevar8x32_epi32(values, back),
+                         _mm256_permutevar8x32_epi32(last, back), 1);
+  int repeated = _mm256_movemask_ps(
+      _mm256_castsi256_ps(_mm256_cmpeq_epi32(previous, values)));
+  int keep = ~repeated & 255;
+  __m256i lanes = _mm256_load_si256(vec256(compact.lanes[keep]));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                      _mm256_permutevar8x32_epi32(values, lanes));
+  return __builtin_popcount(keep);
+}
+
+__attribute__((target("avx2"))) static size_t
+unite_avx2(const uint32_t *a, size_t a_size, const uint32_t *b, size_t b_size,
+           uint32_t *out) {
+  if (a_size < 8 || b_size < 8)
+    return unite_sse(a, a_size, b, b_size, out);
+
+  size_t a_end = a_size & ~size_t(7), b_end = b_size & ~size_t(7);
+  __m256i low, high;
+  merge_network(_mm256_loadu_si256(vec256(a)), _mm256_loadu_si256(vec256(b)),
+                low, high);
+  size_t count = store_unique(_mm256_set1_epi32(-1), low, out);
+  __m256i last = low;
+  size_t i = 8, j = 8;
+  while (i < a_end && j < b_end) {
+    bool from_a = a[i] <= b[j];
+    __m256i next = _mm256_loadu_si256(vec256(from_a ? a + i : b + j));
+    i += from_a ? 8 : 0;
+    j += from_a ? 0 : 8;
+    merge_network(next, high, low, high);
+    count += store_unique(last, low, out + count);
+    last = low;
+  }
+
+  uint32_t pending[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(pending), high);
+  return finish_union(pending, 8, a + i, a_size - i, b + j, b_size - j, out,
+                      count);
+}
+#endif
+
+typedef size_t (*SetFunction)(const uint32_t *, size_t, const uint32_t *,
+                              size_t, uint32_t *);
+
+// AUTO uses shuffle below the first length ratio, V3 below the second and
+// galloping from there on, as measured with postings_bench. V1 never won.
+struct KernelBackend {
+  SetFunction shuffle;
+  SetFunction v1;
+  SetFunction v3;
+  SetFunction unite;
+  size_t shuffle_ratio;
+  size_t gallop_ratio;
+  const char *name;
+};
+
+static bool make_backend(PostingsKernels::Backend kind, KernelBackend &out) {
+  switch (kind) {
+  case PostingsKernels::SCALAR:
+    out = {intersect_merge, intersect_gallop, intersect_gallop, unite_merge,
+           32, 32, "scalar"};
+    return true;
+#ifdef POSTINGS_KERNELS_X86
+  case PostingsKernels::SSE41:
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("sse4.1"))
+      return false;
+    out = {intersect_shuffle_sse, intersect_v1_sse, intersect_v3_sse,
+           unite_sse, 2, 512, "sse4.1"};
+    return true;
+  case PostingsKernels::AVX2:
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx2"))
+      return false;
+    out = {intersect_shuffle_avx2, intersect_v1_avx2, intersect_v3_avx2,
+           unite_avx2, 8, 1024, "avx2"};
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+static KernelBackend select_backend() {
+  KernelBackend selected;
+  if (!make_backend(PostingsKernels::AVX2, selected) &&
+      !make_backend(PostingsKernels::SSE41, selected))
+    make_backend(PostingsKernels::SCALAR, selected);
+  return selected;
+}
+
+static KernelBackend &backend() {
+  static KernelBackend selected = select_backend();
+  return selected;
+}
+
+size_t PostingsKernels::intersect(const uint32_t *a, size_t a_size,
+                                  const uint32_t *b, size_t b_size,
+                                  uint32_t *out, Algorithm algorithm) {
+  if (a_size > b_size) {
+    std::swap(a, b);
+    std::swap(a_size, b_size);
+  }
+  if (a_size == 0)
+    return 0;
+  const KernelBackend &selected = backend();
+  if (algorithm == AUTO) {
+    size_t ratio = b_size / a_size;
+    algorithm = ratio < selected.shuffle_ratio  ? SHUFFLE
+                : ratio < selected.gallop_ratio ? V3
+                                                : GALLOP;
+  }
+  switch (algorithm) {
+  case MERGE:
+    return intersect_merge(a, a_size, b, b_size, out);
+  case SHUFFLE:
+    return selected.shuffle(a, a_size, b, b_size, out);
+  case V1:
+    return selected.v1(a, a_size, b, b_size, out);
+  case V3:
+    return selected.v3(a, a_size, b, b_size, out);
+  default:
+    return intersect_gallop(a, a_size, b, b_size, out);
+  }
+}
+
+size_t PostingsKernels::unite(const uint32_t *a, size_t a_size,
+                              const uint32_t *b, size_t b_size,
+                              uint32_t *out) {
+  return backend().unite(a, a_size, b, b_size, out);
+}
+
+size_t PostingsKernels::unite(const uint32_t *const *lists,
+                              const size_t *sizes, size_t count,
+                              uint32_t *out, std::vector<uint32_t> &scratch) {
+  size_t live = 0, total = 0, picked[2] = {0, 0};
+  for (size_t i = 0; i < count; ++i) {
+    if (sizes[i] == 0)
+      continue;
+    if (live < 2)
+      picked[live] = i;
+    ++live;
+    total += sizes[i];
+  }
+  if (live == 0)
+    return 0;
+  if (live == 1) {
+    std::copy(lists[picked[0]], lists[picked[0]] + total, out);
+    return total;
+  }
+  if (live == 2)
+    return unite(lists[picked[0]], sizes[picked[0]], lists[picked[1]],
+                 sizes[picked[1]], out);
+
+  typedef std::pair<const uint32_t *, size_t> Run;
+  std::vector<Run> runs;
+  for (size_t i = 0; i < count; ++i) {
+    if (sizes[i])
+      runs.emplace_back(lists[i], sizes[i]);
+  }
+
+  // Each round unites neighbours into the half of scratch the round before
+  // did not write, carrying an odd run over by copying it.
+  scratch.resize(2 * (total + kPadding));
+  uint32_t *halves[2] = {scratch.data(), scratch.data() + total + kPadding};
+  for (int side = 0; runs.size() > 2; side ^= 1) {
+    std::sort(runs.begin(), runs.end(), [](const Run &x, const Run &y) {
+      return x.second < y.second;
+    });
+    uint32_t *write = halves[side];
+    std::vector<Run> next;
+    for (size_t i = 0; i + 1 < runs.size(); i += 2) {
+      size_t size = unite(runs[i].first, runs[i].second, runs[i + 1].first,
+                          runs[i + 1].second, write);
+      next.emplace_back(write, size);
+      write += size;
+    }
+    if (runs.size() % 2) {
+      const Run &odd = runs.back();
+      std::copy(odd.first, odd.first + odd.second, write);
+      next.emplace_back(write, odd.second);
+    }
+    runs.swap(next);
+  }
+  return unite(runs[0].first, runs[0].second, runs[1].first, runs[1].second,
+               out);
+}
+
+bool PostingsKernels::use_backend(Backend kind) {
+  KernelBackend selected;
+  if (!make_backend(kind, selected))
+    return false;
+  backend() = selected;
+  return true;
+}
+
+const char *PostingsKernels::backend_name() { return backend().name; }
\ No newline at end of file
@@ -0,0 +1,530 @@
+#include "../../inc/query_plan.h"
+#include "../../inc/postings_kernels.h"
+#include <algorithm>
+
+static const double kK1 = 1.2;
+static const double kB = 0.75;
+static const uint32_t kEnd = PostingCursor::kEnd;
+// A conjunction serves candidates from windows only when its longest child
+// is at most kWindowCostRatio times its rarest one, or each window would be
+// mostly the longer lists' docs, and when at most kWindowHitRate of the
+// rarest child's docs are expected in all the others, or leapfrogging
+// already wastes little.
+static const uint64_t kWindowCostRatio = 8;
+static const double kWindowHitRate = 0.25;
+
+double bm25_score(double idf, uint32_t tf, uint32_t length,
+                  double avg_length) {
+  double norm = kK1 * (1 - kB + kB * length / avg_length);
+  return idf * tf * (kK1 + 1) / (tf + norm);
+}
+
+typedef std::vector<std::unique_ptr<QueryIterator>> Iterators;
+
+class TermIterator : public QueryIterator {
+public:
+  TermIterator(const IndexSegment &segment, const TermEntry &entry, double idf,
+               double avg_length, IndexQueryStats &stats)
+      : segment_(segment), cursor_(segment, entry), idf_(idf),
+        avg_length_(avg_length), stats_(stats) {
+    doc_ = cursor_.doc();
+    cost_ = entry.doc_freq;
+  }
+
+  const PostingCursor &cursor() const { return cursor_; }
+
+  uint32_t next_geq(uint32_t target) override {
+    return doc_ = cursor_.next_geq(target);
+  }
+
+  double score() override {
+    return bm25_score(idf_, cursor_.freq(), segment_.doc_length(doc_),
+                      avg_length_);
+  }
+
+  bool block_bound(uint32_t target, double &bound,
+                   uint32_t &block_end) override {
+    block_end = cursor_.shallow_seek(target);
+    if (block_end == kEnd)
+      return false;
+    const SkipEntry &block = cursor_.shallow_block();
+    bound = bm25_score(idf_, block.max_tf, block.min_length, avg_length_);
+    return true;
+  }
+
+  uint32_t window_end() const override { return cursor_.block_last(); }
+
+  bool window(uint32_t end, const uint32_t *&docs, size_t &size) override {
+    docs = cursor_.block_docs();
+    size = std::upper_bound(docs, docs + cursor_.block_left(), end) - docs;
+    return true;
+  }
+
+  const std::vector<uint32_t> &positions() {
+    if (positions_doc_ != doc_) {
+      cursor_.positions(positions_);
+      positions_doc_ = doc_;
+      ++stats_.positions;
+    }
+    return positions_;
+  }
+
+private:
+  const IndexSegment &segment_;
+  PostingCursor cursor_;
+  double idf_;
+  double avg_length_;
+  IndexQueryStats &stats_;
+  std::vector<uint32_t> positions_;
+  uint32_t positions_doc_ = kEnd;
+};
+
+// Leapfrog intersection led by the child with the fewest matches: the others
+// only seek to its candidates. Once they meet, the blocks they have decoded
+// are intersected in one go and the next candidates served from that
+// window. A candidate matches when every child does, no excluded child
+// does, and accept() agrees.
+class ConjunctionIterator : public QueryIterator {
+public:
+  // docs is the number of docs in the segment, to estimate how many of the
+  // rarest child's candidates the others share.
+  ConjunctionIterator(Iterators required, Iterators excluded, size_t docs)
+      : required_(std::move(required)), excluded_(std::move(excluded)) {
+    std::stable_sort(required_.begin(), required_.end(),
+                     [](const std::unique_ptr<QueryIterator> &a,
+                        const std::unique_ptr<QueryIterator> &b) {
+                       return a->cost() < b->cost();
+                     });
+    cost_ = required_[0]->cost();
+    double hit_rate = 1;
+    for (size_t i = 1; i < required_.size(); ++i)
+      hit_rate *= std::min(1.0, static_cast<double>(required_[i]->cost()) /
+                                    std::max<size_t>(docs, 1));
+    batched_ = required_.size() > 1 &&
+               required_.back()->cost() <= kWindowCostRatio * cost_ &&
+               hit_rate <= kWindowHitRate;
+  }
+
+  uint32_t next_geq(uint32_t target) override {
+    if (started_ && doc_ >= target)
+      return doc_;
+    started_ = true;
+
+    if (windowed_ && target <= window_last_) {
+      while (window_pos_ < window_.size() && window_[window_pos_] < target)
+        ++window_pos_;
+      if (window_pos_ < window_.size()) {
+        doc_ = window_[window_pos_];
+        for (auto &child : required_)
+          child->next_geq(doc_);
+        return doc_;
+      }
+      target = window_last_ + 1;
+    }
+    windowed_ = false;
+
+    uint32_t candidate = required_[0]->next_geq(target);
+    while (candidate != kEnd) {
+      uint32_t next = candidate;
+      for (size_t i = 1; i < required_.size() && next == candidate; ++i)
+        next = required_[i]->next_geq(candidate);
+      if (next == candidate)
+        break;
+      candidate = required_[0]->next_geq(next);
+    }
+    doc_ = candidate;
+    if (candidate != kEnd && batched_) {
+      uint32_t end = window_end();
+      batched_ = fill_window(end);
+    }
+    return doc_;
+  }
+
+  uint32_t window_end() const override {
+    uint32_t end = kEnd;
+    for (auto &child : required_)
+      end = std::min(end, child->window_end());
+    return end;
+  }
+
+  bool window(uint32_t end, const uint32_t *&docs, size_t &size) override {
+    if (batched_ && doc_ != kEnd)
+      batched_ = fill_window(end);
+    docs = window_.data();
+    size = doc_ == kEnd ? 0 : window_.size();
+    return batched_;
+  }
+
+  bool matches() override {
+    for (auto &child : excluded_) {
+      if (child->next_geq(doc_) == doc_ && child->matches())
+        return false;
+    }
+    for (auto &child : required_) {
+      if (!child->matches())
+        return false;
+    }
+    return accept();
+  }
+
+  double score() override {
+    double score = 0;
+    for (auto &child : required_)
+      score += child->score();
+    return score;
+  }
+
+  bool block_bound(uint32_t target, double &bound,
+                   uint32_t &block_end) override {
+    bound = 0;
+    block_end = kEnd;
+    for (auto &child : required_) {
+      double child_bound;
+      uint32_t child_end;
+      if (!child->block_bound(target, child_bound, child_end))
+        return false;
+      bound += child_bound;
+      block_end = std::min(block_end, child_end);
+    }
+    return true;
+  }
+
+protected:
+  virtual bool accept() { return true; }
+
+private:
+  // Intersects the children's windows through end, rarest first. False if
+  // some child has none, which turns windows off for good.
+  bool fill_window(uint32_t end) {
+    windowed_ = false;
+    const uint32_t *docs, *other;
+    size_t size, other_size;
+    if (!required_[0]->window(end, docs, size))
+      return false;
+    for (size_t i = 1; i < required_.size(); ++i) {
+      if (!required_[i]->window(end, other, other_size))
+        return false;
+      scratch_.resize(std::min(size, other_size) + PostingsKernels::kPadding);
+      size = PostingsKernels::intersect(docs, size, other, other_size,
+                                        scratch_.data());
+      window_.swap(scratch_);
+      docs = window_.data();
+    }
+    window_.resize(size);
+    windowed_ = true;
+    window_last_ = end;
+    window_pos_ = 0;
+    return true;
+  }
+
+  Iterators required_;
+  Iterators excluded_;
+  bool started_ = false;
+  bool batched_ = true;
+  bool windowed_ = false;
+  uint32_t window_last_ = 0;
+  size_t window_pos_ = 0;
+  std::vector<uint32_t> window_;
+  std::vector<uint32_t> scratch_;
+};
+
+// The distinct words of a phrase, matched where they occur one after another.
+class PhraseIterator : public ConjunctionIterator {
+public:
+  PhraseIterator(Iterators terms, std::vector<TermIterator *> words,
+                 size_t docs)
+      : ConjunctionIterator(std::move(terms), Iterators(), docs),
+        words_(std::move(words)) {}
+
+  size_t length() const { return words_.size(); }
+
+  // Word positions where the phrase starts in the current match.
+  const std::vector<uint32_t> &starts() {
+    if (starts_doc_ == doc_)
+      return starts_;
+    starts_doc_ = doc_;
+    starts_ = words_[0]->positions();
+    for (size_t i = 1; i < words_.size() && !starts_.empty(); ++i) {
+      const std::vector<uint32_t> &next = words_[i]->positions();
+      starts_.erase(std::remove_if(starts_.begin(), starts_.end(),
+                                   [&](uint32_t start) {
+                                     return !std::binary_search(
+                                         next.begin(), next.end(), start + i);
+                                   }),
+                    starts_.end());
+    }
+    return starts_;
+  }
+
+protected:
+  bool accept() override { return words_.size() == 1 || !starts().empty(); }
+
+private:
+  std::vector<TermIterator *> words_;
+  std::vector<uint32_t> starts_;
+  uint32_t starts_doc_ = kEnd;
+};
+
+class NearIterator : public ConjunctionIterator {
+public:
+  NearIterator(Iterators sides, PhraseIterator *left, PhraseIterator *right,
+               uint32_t distance, size_t docs)
+      : ConjunctionIterator(std::move(sides), Iterators(), docs),
+        left_(left), right_(right), distance_(distance) {}
+
+protected:
+  // Some occurrence of one phrase ends at most distance words before an
+  // occurrence of the other starts.
+  bool accept() override {
+    const std::vector<uint32_t> &left = left_->starts();
+    const std::vector<uint32_t> &right = right_->starts();
+    int64_t left_length = left_->length();
+    int64_t right_length = right_->length();
+    for (uint32_t start : left) {
+      int64_t after = start + left_length;
+      auto it = std::lower_bound(right.begin(), right.end(), after);
+      if (it != right.end() && *it - after <= distance_)
+        return true;
+
+      int64_t before = static_cast<int64_t>(start) - right_length;
+      if (before < 0)
+        continue;
+      it = std::lower_bound(right.begin(), right.end(),
+                            std::max<int64_t>(0, before - distance_));
+      if (it != right.end() && *it <= before)
+        return true;
+    }
+    return false;
+  }
+
+private:
+  PhraseIterator *left_;
+  PhraseIterator *right_;
+  uint32_t distance_;
+};
+
+// Union of its children; a match scores the children that match it. Its
+// window unites theirs.
+class OrIterator : public QueryIterator {
+public:
+  explicit OrIterator(Iterators children)
+      : children_(std::move(children)), matched_(children_.size()),
+        lists_(children_.size()), sizes_(children_.size()) {
+    doc_ = kEnd;
+    for (auto &child : children_) {
+      cost_ += child->cost();
+      doc_ = std::min(doc_, child->next_geq(0));
+    }
+  }
+
+  uint32_t next_geq(uint32_t target) override {
+    if (doc_ >= target)
+      return doc_;
+    doc_ = kEnd;
+    for (auto &child : children_) {
+      uint32_t doc = child->doc();
+      if (doc < target)
+        doc = child->next_geq(target);
+      doc_ = std::min(doc_, doc);
+    }
+    return doc_;
+  }
+
+  bool matches() override {
+    bool any = false;
+    for (size_t i = 0; i < children_.size(); ++i) {
+      matched_[i] = children_[i]->doc() == doc_ && children_[i]->matches();
+      any = any || matched_[i];
+    }
+    return any;
+  }
+
+  double score() override {
+    double score = 0;
+    for (size_t i = 0; i < children_.size(); ++i) {
+      if (matched_[i])
+        score += children_[i]->score();
+    }
+    return score;
+  }
+
+  bool block_bound(uint32_t target, double &bound,
+                   uint32_t &block_end) override {
+    bool live = false;
+    bound = 0;
+    block_end = kEnd;
+    for (auto &child : children_) {
+      double child_bound;
+      uint32_t child_end;
+      if (!child->block_bound(target, child_bound, child_end))
+        continue;
+      live = true;
+      bound += child_bound;
+      block_end = std::min(block_end, child_end);
+    }
+    return live;
+  }
+
+  uint32_t window_end() const override {
+    uint32_t end = kEnd;
+    for (auto &child : children_) {
+      if (child->doc() != kEnd)
+        end = std::min(end, child->window_end());
+    }
+    return end;
+  }
+
+  bool window(uint32_t end, const uint32_t *&docs, size_t &size) override {
+    size_t total = 0;
+    for (size_t i = 0; i < children_.size(); ++i) {
+      sizes_[i] = 0;
+      if (children_[i]->doc() <= end &&
+          !children_[i]->window(end, lists_[i], sizes_[i]))
+        return false;
+      total += sizes_[i];
+    }
+    window_.resize(total + PostingsKernels::kPadding);
+    size = PostingsKernels::unite(lists_.data(), sizes_.data(),
+                                  children_.size(), window_.data(), scratch_);
+    docs = window_.data();
+    return true;
+  }
+
+private:
+  Iterators children_;
+  std::vector<bool> matched_;
+  std::vector<const uint32_t *> lists_;
+  std::vector<size_t> sizes_;
+  std::vector<uint32_t> window_;
+  std::vector<uint32_t> scratch_;
+};
+
+QueryPlanner::QueryPlanner(const IndexSegment &segment,
+                           const std::map<std::string, double> &idf,
+                           double avg_length, IndexQueryStats &stats)
+    : segment_(segment), idf_(idf), avg_length_(avg_length), stats_(stats) {}
+
+double QueryPlanner::idf(const std::string &term) const {
+  auto it = idf_.find(term);
+  return it == idf_.end() ? 0 : it->second;
+}
+
+size_t QueryPlanner::decoded() const {
+  size_t decoded = 0;
+  for (const auto *cursor : cursors_)
+    decoded += cursor->decoded();
+  return decoded;
+}
+
+std::unique_ptr<TermIterator> QueryPlanner::term(const std::string &term,
+                                                 double idf) {
+  const TermEntry *entry = segment_.find(term);
+  if (!entry)
+    return nullptr;
+  stats_.postings += entry->doc_freq;
+  auto iterator = std::make_unique<TermIterator>(segment_, *entry, idf,
+                                                 avg_length_, stats_);
+  cursors_.push_back(&iterator->cursor());
+  return iterator;
+}
+
+std::unique_ptr<PhraseIterator>
+QueryPlanner::phrase(const IndexQuery &query) {
+  Iterators terms;
+  std::vector<TermIterator *> words;
+  for (size_t i = 0; i < query.terms.size(); ++i) {
+    size_t first = std::find(query.terms.begin(), query.terms.end(),
+                             query.terms[i]) -
+                   query.terms.begin();
+    if (first < i) {
+      words.push_back(words[first]);
+      continue;
+    }
+    std::unique_ptr<TermIterator> word =
+        term(query.terms[i], idf(query.terms[i]));
+    if (!word)
+      return nullptr;
+    words.push_back(word.get());
+    terms.push_back(std::move(word));
+  }
+  if (terms.empty())
+    return nullptr;
+  return std::make_unique<PhraseIterator>(std::move(terms), std::move(words),
+                                          segment_.doc_count());
+}
+
+std::unique_ptr<QueryIterator> QueryPlanner::plan(const IndexQuery &query) {
+  switch (query.kind) {
+  case IndexQuery::PHRASE:
+    if (query.terms.size() == 1)
+      return term(query.terms[0], idf(query.terms[0]));
+    return phrase(query);
+
+  case IndexQuery::SITE:
+    if (query.terms.empty())
+      return nullptr;
+    return term(TermTokenizer::site_term(query.terms[0]), 0);
+
+  case IndexQuery::NEAR: {
+    if (query.children.size() != 2)
+      return nullptr;
+    std::unique_ptr<PhraseIterator> left = phrase(query.children[0]);
+    std::unique_ptr<PhraseIterator> right = phrase(query.children[1]);
+    if (!left || !right)
+      return nullptr;
+    PhraseIterator *left_phrase = left.get();
+    PhraseIterator *right_phrase = right.get();
+    Iterators sides;
+    sides.push_back(std::move(left));
+    sides.push_back(std::move(right));
+    return std::make_unique<NearIterator>(std::move(sides), left_phrase,
+                                          right_phrase, query.distance,
+                                          segment_.doc_count());
+  }
+
+  case IndexQuery::AND: {
+    Iterators required;
+    for (const auto &child : query.children) {
+      if (child.kind == IndexQuery::NOT)
+        continue;
+      std::unique_ptr<QueryIterator> iterator = plan(child);
+      if (!iterator)
+        return nullptr;
+      required.push_back(std::move(iterator));
+    }
+    if (required.empty())
+      return nullptr;
+
+    Iterators excluded;
+    for (const auto &child : query.children) {
+      if (child.kind != IndexQuery::NOT || child.children.empty())
+        continue;
+      std::unique_ptr<QueryIterator> iterator = plan(child.children[0]);
+      if (iterator)
+        excluded.push_back(std::move(iterator));
+    }
+    if (required.size() == 1 && excluded.empty())
+      return std::move(required[0]);
+    return std::make_unique<ConjunctionIterator>(
+        std::move(required), std::move(excluded), segment_.doc_count());
+  }
+
+  case IndexQuery::OR: {
+    Iterators children;
+    for (const auto &child : query.children) {
+      std::unique_ptr<QueryIterator> iterator = plan(child);
+      if (iterator)
+        children.push_back(std::move(iterator));
+    }
+    if (children.empty())
+      return nullptr;
+    if (children.size() == 1)
+      return std::move(children[0]);
+    return std::make_unique<OrIterator>(std::move(children));
+  }
+
+  case IndexQuery::NOT:
+    break;
+  }
+  return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include "../../inc/database.h"
+#include "../../inc/index_builder.h"
+#include "../../inc/metrics_collector.h"
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 4) {
+    std::cerr << "Invalid arguments, use ./indexer [db] [index dir] "
+                 "[segment docs]"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string index_dir = argc > 2 ? argv[2] : std::string(argv[1]) + ".index";
+  size_t segment_docs = argc > 3 ? std::stoul(argv[3]) : 100000;
+
+  Database db;
+  db.connect(argv[1], SEARCHER);
+
+  auto start = std::chrono::steady_clock::now();
+  IndexBuilder builder(index_dir, segment_docs);
+  bool ok = true;
+  db.scan_pages([&](const std::string &url, const std::string &text) {
+    ok = builder.add_document(url, text) && ok;
+  });
+  ok = builder.finish() && ok;
+  if (!ok)
+    exit(EXIT_FAILURE);
+
+  double elapsed_sec = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  std::cout << "Indexed " << builder.doc_count() << " pages into "
+            << builder.segment_count() << " segments in " << index_dir << " ("
+            << builder.index_bytes() / 1024 << " KB) in " << elapsed_sec
+            << " s" << std::endl;
+}
\ No newline at end of file
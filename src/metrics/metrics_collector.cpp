@@ -1,5 +1,7 @@
 #include "../../inc/metrics_collector.h"
 #include "../../inc/url_utils.h"
+#include <algorithm>
+#include <sys/resource.h>
 
 MetricsCollector &MetricsCollector::instance() {
   static MetricsCollector instance;
@@ -98,10 +100,14 @@ void MetricsCollector::reset() {
   metrics_.clear();
   timers_.clear();
   active_urls_.clear();
+  counters_.clear();
+  gauges_.clear();
+  domain_bytes_.clear();
   active_threads_ = 0;
   queue_size_ = 0;
   visited_count_ = 0;
-  total_bytes_downloaded_ = 0;
+  total_wire_bytes_ = 0;
+  total_decoded_bytes_ = 0;
 
   start_time_ = std::chrono::high_resolution_clock::now();
 }
@@ -130,6 +136,83 @@ void MetricsCollector::print_report(std::ostream &os) {
   os << "Processing rate: "
      << (total_runtime_sec > 0 ? visited_count_ / total_runtime_sec : 0)
      << " URLs/second\n";
+
+  size_t wire = total_wire_bytes_;
+  size_t decoded = total_decoded_bytes_;
+  os << "Bytes downloaded: " << wire << " on the wire, " << decoded
+     << " decoded";
+  if (wire > 0) {
+    os << " (compression ratio " << static_cast<double>(decoded) / wire
+       << ")";
+  }
+  os << "\n";
+
+  if (!metrics_.empty()) {
+    std::vector<std::string> operations;
+    for (const auto &entry : metrics_) {
+      operations.push_back(entry.first);
+    }
+    std::sort(operations.begin(), operations.end());
+
+    os << "Operations:\n";
+    for (const auto &name : operations) {
+      const auto &metric = metrics_[name];
+      os << "  " << name << ": " << metric.count << " calls, avg "
+         << (metric.count ? metric.total_time_ms / metric.count : 0)
+         << " ms, min " << metric.min_time_ms << " ms, max "
+         << metric.max_time_ms << " ms, total " << metric.total_time_ms
+         << " ms";
+      if (metric.error_count) {
+        os << ", " << metric.error_count << " errors";
+      }
+      os << "\n";
+    }
+  }
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    os << "Peak RSS: " << usage.ru_maxrss / 1024.0 << " MB\n";
+  }
+
+  if (!domain_bytes_.empty()) {
+    std::vector<std::pair<std::string, TransferBytes>> domains(
+        domain_bytes_.begin(), domain_bytes_.end());
+    std::sort(domains.begin(), domains.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    os << "Transfer by domain:\n";
+    for (const auto &entry : domains) {
+      os << "  " << entry.first << ": " << entry.second.wire << " wire, "
+         << entry.second.decoded << " decoded";
+      if (entry.second.wire > 0) {
+        os << ", ratio "
+           << static_cast<double>(entry.second.decoded) / entry.second.wire;
+      }
+      os << "\n";
+    }
+  }
+
+  if (!counters_.empty()) {
+    std::vector<std::pair<std::string, size_t>> counters(counters_.begin(),
+                                                         counters_.end());
+    std::sort(counters.begin(), counters.end());
+    os << "Counters:\n";
+    for (const auto &counter : counters) {
+      os << "  " << counter.first << ": " << counter.second << "\n";
+    }
+  }
+
+  if (!gauges_.empty()) {
+    std::vector<std::pair<std::string, Gauge>> gauges(gauges_.begin(),
+                                                      gauges_.end());
+    std::sort(gauges.begin(), gauges.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    os << "Gauges:\n";
+    for (const auto &gauge : gauges) {
+      os << "  " << gauge.first << ": last " << gauge.second.last << ", avg "
+         << gauge.second.total / gauge.second.samples << ", peak "
+         << gauge.second.peak << "\n";
+    }
+  }
 }
 
 void MetricsCollector::increment_active_threads() { ++active_threads_; }
@@ -156,17 +239,47 @@ double MetricsCollector::get_urls_per_second() {
   return total_runtime_sec > 0 ? visited_count_ / total_runtime_sec : 0;
 }
 
-double MetricsCollector::get_bandwidth_usage() {
+double MetricsCollector::get_bandwidth_usage(bool decoded) {
   auto now = std::chrono::high_resolution_clock::now();
   double total_runtime_sec =
       std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time_)
           .count() /
       1000.0;
-  return total_runtime_sec > 0
-             ? (total_bytes_downloaded_ / 1024.0) / total_runtime_sec
-             : 0;
+  size_t bytes = decoded ? total_decoded_bytes_ : total_wire_bytes_;
+  return total_runtime_sec > 0 ? (bytes / 1024.0) / total_runtime_sec : 0;
+}
+
+void MetricsCollector::add_bytes_downloaded(size_t wire_bytes,
+                                            size_t decoded_bytes,
+                                            const std::string &domain) {
+  total_wire_bytes_ += wire_bytes;
+  total_decoded_bytes_ += decoded_bytes;
+
+  if (!domain.empty()) {
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    auto &bytes = domain_bytes_[domain];
+    bytes.wire += wire_bytes;
+    bytes.decoded += decoded_bytes;
+  }
 }
 
-void MetricsCollector::add_bytes_downloaded(size_t bytes) {
-  total_bytes_downloaded_ += bytes;
+void MetricsCollector::increment_counter(const std::string &name,
+                                         size_t delta) {
+  std::lock_guard<std::mutex> lock(metrics_mutex_);
+  counters_[name] += delta;
+}
+
+size_t MetricsCollector::get_counter(const std::string &name) {
+  std::lock_guard<std::mutex> lock(metrics_mutex_);
+  auto it = counters_.find(name);
+  return it != counters_.end() ? it->second : 0;
+}
+
+void MetricsCollector::record_gauge(const std::string &name, size_t value) {
+  std::lock_guard<std::mutex> lock(metrics_mutex_);
+  Gauge &gauge = gauges_[name];
+  gauge.last = value;
+  gauge.peak = std::max(gauge.peak, value);
+  gauge.samples++;
+  gauge.total += value;
 }
\ No newline at end of file
@@ -0,0 +1,402 @@
+#include "../../inc/partition_exchange.h"
+#include "../../inc/url_utils.h"
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const size_t kMaxDatagram = 60 * 1024;
+static const size_t kMaxUrlLength = 8 * 1024;
+static const int kFlushIntervalMs = 100;
+
+// Control messages start with '!', which no "depth\turl" line does.
+static const char kReportMessage[] = "!report";
+static const char kDoneMessage[] = "!done";
+
+static sockaddr_un make_address(const std::string &group,
+                                const std::string &suffix,
+                                socklen_t &length) {
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  std::string name = group + "." + suffix;
+  name.resize(std::min(name.size(), sizeof(addr.sun_path) - 1));
+
+  addr.sun_path[0] = '\0';
+  std::memcpy(addr.sun_path + 1, name.data(), name.size());
+  length = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+  return addr;
+}
+
+static sockaddr_un make_address(const std::string &group, size_t partition,
+                                socklen_t &length) {
+  return make_address(group, std::to_string(partition), length);
+}
+
+static sockaddr_un coordinator_address(const std::string &group,
+                                       socklen_t &length) {
+  return make_address(group, "coordinator", length);
+}
+
+static bool send_datagram(int fd, const sockaddr_un &addr, socklen_t length,
+                          const std::string &message) {
+  ssize_t sent;
+  do {
+    sent = sendto(fd, message.data(), message.size(), 0,
+                  reinterpret_cast<const sockaddr *>(&addr), length);
+  } while (sent < 0 && errno == EINTR);
+  return sent >= 0;
+}
+
+std::vector<int> PartitionExchange::bind_sockets(const std::string &group,
+                                                 size_t partition_count) {
+  std::vector<int> fds;
+
+  for (size_t i = 0; i < partition_count; ++i) {
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      std::cerr << "Failed to create partition socket: " << strerror(errno)
+                << std::endl;
+      break;
+    }
+
+    int buffer_size = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+    socklen_t length;
+    sockaddr_un addr = make_address(group, i, length);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), length) != 0) {
+      std::cerr << "Failed to bind partition socket " << i << ": "
+                << strerror(errno) << std::endl;
+      close(fd);
+      break;
+    }
+    fds.push_back(fd);
+  }
+
+  if (fds.size() != partition_count) {
+    for (int fd : fds)
+      close(fd);
+    fds.clear();
+  }
+  return fds;
+}
+
+size_t PartitionExchange::partition_for(const std::string &url,
+                                        size_t partition_count) {
+  if (partition_count <= 1)
+    return 0;
+  return std::hash<std::string>{}(UrlUtils::extract_domain(url)) %
+         partition_count;
+}
+
+PartitionExchange::PartitionExchange(const std::string &group,
+                                     size_t partition_id,
+                                     size_t partition_count, int socket_fd,
+                                     size_t batch_size)
+    : group_(group), partition_id_(partition_id),
+      partition_count_(partition_count), socket_fd_(socket_fd),
+      batch_size_(batch_size ? batch_size : 1) {
+  send_fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (send_fd_ < 0) {
+    throw std::runtime_error("Failed to create partition send socket");
+  }
+
+  for (size_t i = 0; i < partition_count_; ++i) {
+    outboxes_.push_back(std::make_unique<Outbox>());
+  }
+}
+
+PartitionExchange::~PartitionExchange() {
+  stop();
+  if (send_fd_ >= 0)
+    close(send_fd_);
+  if (socket_fd_ >= 0)
+    close(socket_fd_);
+}
+
+bool PartitionExchange::owns(const std::string &url) const {
+  return partition_for(url, partition_count_) == partition_id_;
+}
+
+void PartitionExchange::send(const std::string &url, int depth) {
+  if (url.empty())
+    return;
+  if (url.size() > kMaxUrlLength) {
+    dropped_++;
+    return;
+  }
+
+  size_t partition = partition_for(url, partition_count_);
+  if (partition == partition_id_)
+    return;
+
+  bool full = false;
+  {
+    Outbox &outbox = *outboxes_[partition];
+    std::lock_guard<std::mutex> lock(outbox.mutex);
+    outbox.batch += std::to_string(depth);
+    outbox.batch += '\t';
+    outbox.batch += url;
+    outbox.batch += '\n';
+    outbox.count++;
+    full = outbox.count >= batch_size_ ||
+           outbox.batch.size() + kMaxUrlLength > kMaxDatagram;
+  }
+
+  if (full)
+    flush_outbox(partition);
+}
+
+void PartitionExchange::flush() {
+  for (size_t i = 0; i < partition_count_; ++i) {
+    if (i != partition_id_)
+      flush_outbox(i);
+  }
+}
+
+void PartitionExchange::flush_outbox(size_t partition) {
+  std::string batch;
+  size_t count = 0;
+  {
+    Outbox &outbox = *outboxes_[partition];
+    std::lock_guard<std::mutex> lock(outbox.mutex);
+    batch.swap(outbox.batch);
+    count = outbox.count;
+    outbox.count = 0;
+  }
+
+  if (batch.empty())
+    return;
+
+  socklen_t length;
+  sockaddr_un addr = make_address(group_, partition, length);
+  if (!send_datagram(send_fd_, addr, length, batch)) {
+    std::cerr << "Partition " << partition_id_ << " failed to send " << count
+              << " URLs to partition " << partition << ": " << strerror(errno)
+              << std::endl;
+    dropped_ += count;
+    return;
+  }
+  sent_ += count;
+}
+
+// Idleness is read before the outboxes are flushed, so that the counters
+// cover every URL queued while the crawler was still busy.
+void PartitionExchange::report() {
+  bool idle = idle_();
+  flush();
+
+  std::string message = kReportMessage;
+  message += ' ' + std::to_string(partition_id_);
+  message += ' ' + std::to_string(idle ? 1 : 0);
+  message += ' ' + std::to_string(sent_.load());
+  message += ' ' + std::to_string(received_.load());
+
+  socklen_t length;
+  sockaddr_un addr = coordinator_address(group_, length);
+  if (!send_datagram(send_fd_, addr, length, message)) {
+    std::cerr << "Partition " << partition_id_
+              << " failed to report to the coordinator: " << strerror(errno)
+              << std::endl;
+  }
+}
+
+void PartitionExchange::handle_control(const char *message, size_t length) {
+  if (std::string(message, length).compare(0, sizeof(kDoneMessage) - 1,
+                                           kDoneMessage) != 0)
+    return;
+  if (!finished_.exchange(true) && finished_callback_)
+    finished_callback_();
+}
+
+void PartitionExchange::start(Receiver receiver, IdleCheck idle,
+                              Finished finished) {
+  if (running_)
+    return;
+
+  receiver_ = std::move(receiver);
+  idle_ = std::move(idle);
+  finished_callback_ = std::move(finished);
+  running_ = true;
+  receive_thread_ = std::thread(&PartitionExchange::receive_loop, this);
+  flush_thread_ = std::thread(&PartitionExchange::flush_loop, this);
+}
+
+void PartitionExchange::stop() {
+  if (!running_.exchange(false))
+    return;
+
+  if (receive_thread_.joinable())
+    receive_thread_.join();
+  if (flush_thread_.joinable())
+    flush_thread_.join();
+  flush();
+}
+
+void PartitionExchange::receive_loop() {
+  std::vector<char> buffer(kMaxDatagram + 1);
+
+  while (running_) {
+    pollfd pfd;
+    pfd.fd = socket_fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if (poll(&pfd, 1, kFlushIntervalMs) <= 0)
+      continue;
+
+    ssize_t received = recv(socket_fd_, buffer.data(), buffer.size(), 0);
+    if (received <= 0)
+      continue;
+    if (buffer[0] == '!') {
+      handle_control(buffer.data(), static_cast<size_t>(received));
+      continue;
+    }
+
+    size_t pos = 0;
+    size_t end = static_cast<size_t>(received);
+    while (pos < end) {
+      const char *line = buffer.data() + pos;
+      const char *newline =
+          static_cast<const char *>(std::memchr(line, '\n', end - pos));
+      size_t line_length = newline ? newline - line : end - pos;
+      pos += line_length + 1;
+
+      const char *tab =
+          static_cast<const char *>(std::memchr(line, '\t', line_length));
+      if (!tab)
+        continue;
+
+      int depth = std::atoi(std::string(line, tab - line).c_str());
+      std::string url(tab + 1, line + line_length - tab - 1);
+      if (url.empty())
+        continue;
+
+      received_++;
+      receiver_(url, depth);
+    }
+  }
+}
+
+void PartitionExchange::flush_loop() {
+  while (running_) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kFlushIntervalMs));
+    if (!finished_)
+      report();
+  }
+}
+
+PartitionCoordinator::PartitionCoordinator(const std::string &group,
+                                           size_t partition_count)
+    : group_(group), partition_count_(partition_count),
+      wave_(partition_count), last_wave_(partition_count) {}
+
+PartitionCoordinator::~PartitionCoordinator() {
+  if (socket_fd_ >= 0)
+    close(socket_fd_);
+}
+
+bool PartitionCoordinator::bind() {
+  socket_fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (socket_fd_ < 0) {
+    std::cerr << "Failed to create coordinator socket: " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+
+  socklen_t length;
+  sockaddr_un addr = coordinator_address(group_, length);
+  if (::bind(socket_fd_, reinterpret_cast<sockaddr *>(&addr), length) != 0) {
+    std::cerr << "Failed to bind coordinator socket: " << strerror(errno)
+              << std::endl;
+    close(socket_fd_);
+    socket_fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+bool PartitionCoordinator::poll(int timeout_ms) {
+  char buffer[256];
+  pollfd pfd;
+  pfd.fd = socket_fd_;
+  pfd.events = POLLIN;
+
+  while (!terminated_) {
+    pfd.revents = 0;
+    if (::poll(&pfd, 1, timeout_ms) <= 0)
+      break;
+    ssize_t received = recv(socket_fd_, buffer, sizeof(buffer), 0);
+    if (received > 0)
+      handle_report(buffer, static_cast<size_t>(received));
+    timeout_ms = 0;
+  }
+  return terminated_;
+}
+
+void PartitionCoordinator::handle_report(const char *message, size_t length) {
+  std::string text(message, length);
+  if (text.compare(0, sizeof(kReportMessage) - 1, kReportMessage) != 0)
+    return;
+
+  unsigned long long partition, idle, sent, received;
+  if (std::sscanf(text.c_str() + sizeof(kReportMessage) - 1,
+                  "%llu %llu %llu %llu", &partition, &idle, &sent,
+                  &received) != 4 ||
+      partition >= partition_count_)
+    return;
+
+  Report &report = wave_[partition];
+  if (!report.seen)
+    wave_size_++;
+  report.seen = true;
+  report.idle = idle != 0;
+  report.sent = sent;
+  report.received = received;
+
+  if (wave_size_ < partition_count_)
+    return;
+
+  terminated_ = quiescent();
+  last_wave_.swap(wave_);
+  wave_.assign(partition_count_, Report());
+  wave_size_ = 0;
+}
+
+// Every report of a wave arrives after the previous wave is complete, so a
+// partition whose counters did not change between the two did not send or
+// receive anything in between, and being idle at both ends it stayed idle.
+bool PartitionCoordinator::quiescent() const {
+  size_t sent = 0, received = 0;
+  for (size_t i = 0; i < partition_count_; ++i) {
+    const Report &now = wave_[i];
+    const Report &before = last_wave_[i];
+    if (!before.seen || !now.idle || !before.idle ||
+        now.sent != before.sent || now.received != before.received)
+      return false;
+    sent += now.sent;
+    received += now.received;
+  }
+  return sent == received;
+}
+
+void PartitionCoordinator::finish() {
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return;
+  for (size_t i = 0; i < partition_count_; ++i) {
+    socklen_t length;
+    sockaddr_un addr = make_address(group_, i, length);
+    send_datagram(fd, addr, length, kDoneMessage);
+  }
+  close(fd);
+}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "../../inc/postings_kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+
+typedef std::vector<uint32_t> Postings;
+
+static const PostingsKernels::Backend kBackends[] = {
+    PostingsKernels::SCALAR, PostingsKernels::SSE41, PostingsKernels::AVX2};
+
+struct NamedAlgorithm {
+  PostingsKernels::Algorithm algorithm;
+  const char *name;
+  bool vector;
+};
+
+static const NamedAlgorithm kAlgorithms[] = {
+    {PostingsKernels::MERGE, "merge", false},
+    {PostingsKernels::GALLOP, "gallop", false},
+    {PostingsKernels::SHUFFLE, "shuffle", true},
+    {PostingsKernels::V1, "v1", true},
+    {PostingsKernels::V3, "v3", true},
+    {PostingsKernels::AUTO, "auto", false}};
+
+// The postings of the word of the given rank in a Zipfian vocabulary, where
+// the most common word occurs in half of the docs.
+static Postings zipf_postings(uint32_t docs, size_t rank, std::mt19937 &rng) {
+  double p = 0.5 / rank;
+  std::geometric_distribution<uint32_t> gap(p);
+  Postings postings;
+  for (uint64_t doc = gap(rng); doc < docs; doc += 1 + gap(rng))
+    postings.push_back(static_cast<uint32_t>(doc));
+  return postings;
+}
+
+static Postings random_postings(size_t size, uint32_t universe,
+                                std::mt19937 &rng) {
+  Postings postings;
+  for (size_t i = 0; i < size; ++i)
+    postings.push_back(rng() % universe);
+  std::sort(postings.begin(), postings.end());
+  postings.erase(std::unique(postings.begin(), postings.end()),
+                 postings.end());
+  return postings;
+}
+
+static Postings reference_intersection(const Postings &a, const Postings &b) {
+  Postings out;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::back_inserter(out));
+  return out;
+}
+
+static Postings reference_union(const std::vector<Postings> &lists) {
+  Postings out;
+  for (const Postings &list : lists) {
+    Postings merged;
+    std::set_union(out.begin(), out.end(), list.begin(), list.end(),
+                   std::back_inserter(merged));
+    out.swap(merged);
+  }
+  return out;
+}
+
+// The kernels write into out, grown once so that timed runs do not
+// allocate.
+static size_t intersect(const Postings &a, const Postings &b,
+                        PostingsKernels::Algorithm algorithm, Postings &out) {
+  size_t capacity = std::min(a.size(), b.size()) + PostingsKernels::kPadding;
+  if (out.size() < capacity)
+    out.resize(capacity);
+  return PostingsKernels::intersect(a.data(), a.size(), b.data(), b.size(),
+                                    out.data(), algorithm);
+}
+
+static size_t unite(const std::vector<Postings> &lists, Postings &out,
+                    Postings &scratch) {
+  std::vector<const uint32_t *> data;
+  std::vector<size_t> sizes;
+  size_t total = 0;
+  for (const Postings &list : lists) {
+    data.push_back(list.data());
+    sizes.push_back(list.size());
+    total += list.size();
+  }
+  if (out.size() < total + PostingsKernels::kPadding)
+    out.resize(total + PostingsKernels::kPadding);
+  return PostingsKernels::unite(data.data(), sizes.data(), lists.size(),
+                                out.data(), scratch);
+}
+
+static bool same(const Postings &expected, const Postings &out, size_t size) {
+  return size == expected.size() &&
+         std::equal(expected.begin(), expected.end(), out.begin());
+}
+
+// Runs op until it has taken a fifth of a second and returns microseconds
+// per run.
+template <typename Op> static double time_us(Op op) {
+  size_t runs = 0;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  do {
+    op();
+    ++runs;
+    elapsed = std::chrono::duration<double, std::micro>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  } while (elapsed < 200000);
+  return elapsed / runs;
+}
+
+// Compares every kernel with the standard library on small random lists,
+// which reach the scalar tails and the repeats the vector code handles.
+static bool self_check(std::mt19937 &rng) {
+  Postings out, scratch;
+  for (int round = 0; round < 2000; ++round) {
+    uint32_t universe = 16 + rng() % 2000;
+    Postings a = random_postings(rng() % 300, universe, rng);
+    Postings b = random_postings(rng() % 300, universe, rng);
+    Postings expected = reference_intersection(a, b);
+    for (const NamedAlgorithm &named : kAlgorithms) {
+      if (!same(expected, out, intersect(a, b, named.algorithm, out))) {
+        std::cerr << PostingsKernels::backend_name() << " " << named.name
+                  << " intersection is wrong" << std::endl;
+        return false;
+      }
+    }
+    std::vector<Postings> lists(1 + rng() % 6);
+    for (Postings &list : lists)
+      list = random_postings(rng() % 200, universe, rng);
+    if (!same(reference_union(lists), out, unite(lists, out, scratch))) {
+      std::cerr << PostingsKernels::backend_name() << " union is wrong"
+                << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 2) {
+    std::cerr << "Invalid arguments, use ./postings_bench [docs]" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  uint32_t docs = argc > 1 ? std::stoul(argv[1]) : 10000000;
+  std::mt19937 rng(42);
+
+  const size_t ranks[][2] = {{1, 1},  {1, 2},   {1, 4},    {1, 16},
+                             {1, 64}, {1, 256}, {1, 1024}, {1, 4096}};
+  std::vector<std::pair<Postings, Postings>> pairs;
+  for (const auto &rank : ranks)
+    pairs.emplace_back(zipf_postings(docs, rank[0], rng),
+                       zipf_postings(docs, rank[1], rng));
+  const size_t ways[] = {2, 4, 8, 16};
+  std::vector<std::vector<Postings>> unions;
+  for (size_t k : ways) {
+    std::vector<Postings> lists;
+    for (size_t rank = 4; rank < 4 + k; ++rank)
+      lists.push_back(zipf_postings(docs, rank, rng));
+    unions.push_back(lists);
+  }
+
+  std::cout << std::fixed << std::setprecision(1);
+  for (PostingsKernels::Backend backend : kBackends) {
+    if (!PostingsKernels::use_backend(backend))
+      continue;
+    std::string name = PostingsKernels::backend_name();
+    if (!self_check(rng))
+      exit(EXIT_FAILURE);
+    Postings out, scratch;
+
+    std::cout << "\n" << name << " intersection, us per call\n";
+    std::cout << std::setw(20) << "sizes";
+    for (const NamedAlgorithm &named : kAlgorithms)
+      std::cout << std::setw(10) << named.name;
+    std::cout << "\n";
+    for (const auto &pair : pairs) {
+      Postings expected = reference_intersection(pair.first, pair.second);
+      std::cout << std::setw(20)
+                << std::to_string(pair.first.size()) + "/" +
+                       std::to_string(pair.second.size());
+      for (const NamedAlgorithm &named : kAlgorithms) {
+        if (named.vector && backend == PostingsKernels::SCALAR) {
+          std::cout << std::setw(10) << "-";
+          continue;
+        }
+        size_t size = intersect(pair.first, pair.second, named.algorithm, out);
+        if (!same(expected, out, size)) {
+          std::cerr << name << " " << named.name << " intersection is wrong"
+                    << std::endl;
+          exit(EXIT_FAILURE);
+        }
+        std::cout << std::setw(10) << time_us([&] {
+          intersect(pair.first, pair.second, named.algorithm, out);
+        });
+      }
+      std::cout << "\n";
+    }
+
+    std::cout << name << " union, us per call\n";
+    for (const auto &lists : unions) {
+      if (!same(reference_union(lists), out, unite(lists, out, scratch))) {
+        std::cerr << name << " union is wrong" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      size_t total = 0;
+      for (const Postings &list : lists)
+        total += list.size();
+      std::cout << std::setw(20)
+                << std::to_string(lists.size()) + " lists, " +
+                       std::to_string(total)
+                << std::setw(10)
+                << time_us([&] { unite(lists, out, scratch); }) << "\n";
+    }
+  }
+}
\ No newline at end of file
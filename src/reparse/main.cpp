@@ -0,0 +1,172 @@
+#include "../../inc/crawler_config.h"
+#include "../../inc/database.h"
+#include "../../inc/html_tokenizer.h"
+#include "../../inc/htmlparser.h"
+#include "../../inc/metrics_collector.h"
+#include "../../inc/response_archive.h"
+#include "../../inc/url_utils.h"
+#include <algorithm>
+#include <atomic>
+#include <strings.h>
+#include <thread>
+
+struct ReparseJob {
+  const ArchiveSegment *segment;
+  const ArchiveIndexEntry *entry;
+};
+
+static std::string header_value(const std::string &headers,
+                                const std::string &name) {
+  size_t start = 0;
+  while (start < headers.size()) {
+    size_t end = headers.find("\r\n", start);
+    if (end == std::string::npos)
+      end = headers.size();
+    size_t colon = headers.find(':', start);
+    if (colon < end && colon - start == name.size() &&
+        strncasecmp(headers.c_str() + start, name.c_str(), name.size()) == 0) {
+      size_t value = headers.find_first_not_of(" \t", colon + 1);
+      return value < end ? headers.substr(value, end - value) : "";
+    }
+    start = end + 2;
+  }
+  return "";
+}
+
+static void reparse(const CrawlerConfig &config, const ReparseJob &job,
+                    HTMLParser &parser, Database &db) {
+  ArchiveRecord record;
+  if (!job.segment->read(*job.entry, record)) {
+    MetricsCollector::instance().increment_counter("reparse_corrupt_records");
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  ParsedPage page;
+  if (config.streaming_parse) {
+    HtmlTokenizer tokenizer(page, record.url);
+    tokenizer.feed(record.body.data(), record.body.size());
+    tokenizer.finish();
+  } else {
+    page = parser.parse(record.body, record.url);
+  }
+  double parse_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  MetricsCollector::instance().record_metric(
+      "html_parse", parse_ms, true, UrlUtils::extract_domain(record.url));
+
+  if (page.noindex) {
+    MetricsCollector::instance().increment_counter("reparse_noindex_skipped");
+    return;
+  }
+
+  std::string storage_url = record.url;
+  if (!page.canonical.empty()) {
+    std::string canonical = UrlUtils::normalize_url(page.canonical);
+    if (UrlUtils::is_same_domain(canonical,
+                                 UrlUtils::extract_domain(record.url)) ||
+        UrlUtils::is_same_domain(record.url,
+                                 UrlUtils::extract_domain(canonical)))
+      storage_url = canonical;
+  }
+
+  PageFetchInfo info;
+  info.etag = header_value(record.headers, "ETag");
+  info.last_modified = header_value(record.headers, "Last-Modified");
+  info.http_status = record.http_status;
+  info.fetched_at = record.fetched_at;
+  info.body_bytes = record.body.size();
+  info.parse_ms = parse_ms;
+  db.insert_page(storage_url, page.text, info);
+  MetricsCollector::instance().increment_counter("reparse_pages_stored");
+  MetricsCollector::instance().increment_counter("reparse_body_bytes",
+                                                 record.body.size());
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::cerr << "Invalid arguments, use ./reparse [config] [output db]"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  CrawlerConfig config = CrawlerConfig::load_from_file(argv[1]);
+  if (config.archive_dir.empty()) {
+    std::cerr << "No archive_dir set in " << argv[1] << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  UrlUtils::set_query_rules(config.strip_query_params,
+                            config.sort_query_params);
+  MetricsCollector::instance().reset();
+
+  std::vector<std::unique_ptr<ArchiveSegment>> segments;
+  std::unordered_map<std::string, ReparseJob> latest;
+  for (const auto &path : ArchiveSegment::list(config.archive_dir)) {
+    auto segment = std::make_unique<ArchiveSegment>();
+    if (!segment->open(path))
+      continue;
+    for (const auto &entry : segment->entries()) {
+      if (entry.http_status < 200 || entry.http_status >= 300)
+        continue;
+      auto it = latest.find(entry.url);
+      if (it == latest.end() ||
+          it->second.entry->fetched_at <= entry.fetched_at)
+        latest[entry.url] = ReparseJob{segment.get(), &entry};
+    }
+    segments.push_back(std::move(segment));
+  }
+
+  std::vector<ReparseJob> jobs;
+  jobs.reserve(latest.size());
+  for (const auto &job : latest)
+    jobs.push_back(job.second);
+  std::sort(jobs.begin(), jobs.end(),
+            [](const ReparseJob &a, const ReparseJob &b) {
+              return a.segment != b.segment
+                         ? a.segment < b.segment
+                         : a.entry->offset < b.entry->offset;
+            });
+
+  Database db;
+  db.connect(argv[2], CRAWLER);
+  db.create_table();
+  db.set_batching(config.db_batch_size, config.db_batch_ms);
+  db.set_cache_size(config.db_cache_kb);
+  db.set_compression(config.compress_content, config.zstd_level,
+                     config.zstd_dict_size, config.zstd_dict_training_samples);
+  FtsMode fts_mode = Database::parse_fts_mode(config.fts_index);
+  db.set_fts_mode(fts_mode);
+  db.start_writer(config.db_writer_queue_size);
+
+  HTMLParser parser;
+  parser.set_use_arena(config.gumbo_arena);
+
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<size_t> next{0};
+  size_t thread_count = std::max<size_t>(1, config.thread_count);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < thread_count; ++i) {
+    workers.emplace_back([&]() {
+      for (size_t job = next++; job < jobs.size(); job = next++)
+        reparse(config, jobs[job], parser, db);
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
+  db.stop_writer();
+  if (fts_mode == FtsMode::BULK)
+    db.build_fts();
+
+  double elapsed_sec = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  MetricsCollector &metrics = MetricsCollector::instance();
+  size_t stored = metrics.get_counter("reparse_pages_stored");
+  double body_mb = metrics.get_counter("reparse_body_bytes") / 1048576.0;
+  std::cout << "Reparsed " << jobs.size() << " archived responses from "
+            << segments.size() << " segments into " << argv[2] << " ("
+            << stored << " pages stored) in " << elapsed_sec << " s, "
+            << (elapsed_sec > 0 ? body_mb / elapsed_sec : 0) << " MB/s"
+            << std::endl;
+}
\ No newline at end of file
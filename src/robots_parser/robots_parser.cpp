@@ -1,4 +1,5 @@
 #include "../../inc/robots_parser.h"
+#include "../../inc/metrics_collector.h"
 #include "../../inc/url_utils.h"
 #include <curl/curl.h>
 #include <iostream>
@@ -120,6 +121,7 @@ void RobotsParser::fetch_robots_txt(const std::string &domain) {
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA, &content);
   curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
   CURLcode res = curl_easy_perform(curl);
 
   if (res != CURLE_OK) {
@@ -129,6 +131,11 @@ void RobotsParser::fetch_robots_txt(const std::string &domain) {
     res = curl_easy_perform(curl);
   }
 
+  curl_off_t wire_bytes = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+  MetricsCollector::instance().add_bytes_downloaded(wire_bytes, content.size(),
+                                                    domain);
+
   curl_easy_cleanup(curl);
 
   if (res != CURLE_OK || content.empty()) {
@@ -184,6 +191,15 @@ void RobotsParser::fetch_robots_txt(const std::string &domain) {
           robots_cache[domain][current_agent].allow_rules.push_back(path);
         }
       }
+    } else if (line.substr(0, 7) == "Sitemap" ||
+               line.substr(0, 7) == "sitemap") {
+      size_t colon = line.find(':');
+      if (colon != std::string::npos && colon + 1 < line.size()) {
+        std::string sitemap = trim_whitespace(line.substr(colon + 1));
+        if (!sitemap.empty()) {
+          sitemap_cache[domain].push_back(sitemap);
+        }
+      }
     } else if (line.substr(0, 11) == "Crawl-delay" ||
                line.substr(0, 11) == "crawl-delay") {
       size_t colon = line.find(':');
@@ -201,6 +217,18 @@ void RobotsParser::fetch_robots_txt(const std::string &domain) {
   }
 }
 
+std::vector<std::string>
+RobotsParser::get_sitemaps(const std::string &domain) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+
+  if (robots_cache.find(domain) == robots_cache.end()) {
+    fetch_robots_txt(domain);
+  }
+
+  auto it = sitemap_cache.find(domain);
+  return it != sitemap_cache.end() ? it->second : std::vector<std::string>();
+}
+
 bool RobotsParser::matches_pattern(const std::string &url,
                                    const std::string &pattern) {
 
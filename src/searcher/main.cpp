@@ -1,12 +1,163 @@
+#include "../../inc/metrics_collector.h"
+#include "../../inc/search_server.h"
 #include "../../inc/searcher.h"
+#include <csignal>
+#include <thread>
+
+static SearchServer *running_server = nullptr;
+
+static void usage() {
+  std::cerr << "Invalid arguments, use:\n"
+               "  ./searcher [--limit N] [--any] [db] [query]\n"
+               "  ./searcher --serve [address] [--threads N] [--cache-mb N] "
+               "[db]\n"
+               "  ./searcher --client [address] [--limit N] [--any] [query]"
+            << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+static void handle_signal(int) {
+  if (running_server)
+    running_server->stop();
+}
+
+static int serve(const std::string &address, size_t thread_count,
+                 size_t cache_mb, char *database) {
+  Searcher searcher(database, cache_mb * 1024 * 1024);
+  SearchServer server(searcher, thread_count);
+  if (!server.listen(address))
+    return EXIT_FAILURE;
+
+  running_server = &server;
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+  std::cerr << "Serving " << database << " on " << address << " with "
+            << thread_count << " threads" << std::endl;
+  server.run();
+  running_server = nullptr;
+
+  MetricsCollector &collector = MetricsCollector::instance();
+  auto metrics = collector.get_metrics();
+  auto requests = metrics.find("search_request");
+  if (requests != metrics.end() && requests->second.count)
+    std::cerr << "Served " << requests->second.count << " queries, "
+              << requests->second.total_time_ms / requests->second.count
+              << " ms average, " << requests->second.error_count << " errors"
+              << std::endl;
+
+  size_t hits = collector.get_counter("search_cache_hits");
+  size_t lookups = hits + collector.get_counter("search_cache_misses");
+  if (lookups)
+    std::cerr << "Result cache: " << 100.0 * hits / lookups << "% hit ratio, "
+              << metrics["search_cache_saved"].total_time_ms
+              << " ms of query time saved, "
+              << collector.get_counter("search_cache_evictions")
+              << " evictions, "
+              << collector.get_counter("search_cache_rejections")
+              << " rejections, "
+              << collector.get_counter("search_cache_invalidations")
+              << " invalidations" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+static int client(const std::string &address, const std::vector<char *> &args,
+                  size_t limit, bool match_all) {
+  SearchClient client;
+  if (!client.connect(address))
+    return EXIT_FAILURE;
+
+  if (args.size() == 1) {
+    std::vector<std::string> links;
+    std::string error;
+    if (!client.search(args[0], limit, match_all, links, &error)) {
+      std::cerr << "Search failed: " << error << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (const auto &el : links)
+      std::cout << el << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  // Without a query, forward request lines from stdin and print the replies.
+  std::string line;
+  std::string reply;
+  while (std::getline(std::cin, line)) {
+    if (line.empty())
+      continue;
+    if (!client.request(line, reply)) {
+      std::cerr << "Connection to " << address << " closed" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << reply << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
 
 int main(int argc, char **argv) {
-  if (argc != 3) {
-    std::cerr << "Invalid arguments, use ./searcher [db] [query]" << std::endl;
-    exit(EXIT_FAILURE);
+  size_t limit = Searcher::kDefaultLimit;
+  bool match_all = true;
+  std::string serve_address;
+  std::string client_address;
+  size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+  size_t cache_mb = Searcher::kDefaultCacheBytes / (1024 * 1024);
+  std::vector<char *> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--limit" && has_value) {
+      char *end = nullptr;
+      limit = std::strtoull(argv[++i], &end, 10);
+      if (*end || limit == 0)
+        usage();
+    } else if (arg == "--threads" && has_value) {
+      thread_count = std::strtoull(argv[++i], nullptr, 10);
+      if (thread_count == 0)
+        usage();
+    } else if (arg == "--cache-mb" && has_value) {
+      char *end = nullptr;
+      cache_mb = std::strtoull(argv[++i], &end, 10);
+      if (*end)
+        usage();
+    } else if (arg == "--serve" && has_value) {
+      serve_address = argv[++i];
+    } else if (arg == "--client" && has_value) {
+      client_address = argv[++i];
+    } else if (arg == "--any") {
+      match_all = false;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+
+  if (!serve_address.empty()) {
+    if (args.size() != 1 || !client_address.empty())
+      usage();
+    return serve(serve_address, thread_count, cache_mb, args[0]);
+  }
+  if (!client_address.empty()) {
+    if (args.size() > 1)
+      usage();
+    return client(client_address, args, limit, match_all);
   }
-  Searcher searcher(argv[1]);
-  std::vector<std::string> links = searcher.search(argv[2]);
+  if (args.size() != 2)
+    usage();
+
+  Searcher searcher(args[0], 0);
+  std::vector<std::string> links = searcher.search(args[1], limit, match_all);
   for (const auto &el : links)
     std::cout << el << std::endl;
+
+  MetricsCollector &collector = MetricsCollector::instance();
+  auto metrics = collector.get_metrics();
+  auto decompress = metrics.find("zstd_decompress");
+  if (decompress != metrics.end())
+    std::cerr << "Decompressed " << decompress->second.count << " pages in "
+              << decompress->second.total_time_ms << " ms" << std::endl;
+  size_t postings = collector.get_counter("index_postings");
+  if (postings)
+    std::cerr << "Decoded " << collector.get_counter("index_postings_decoded")
+              << " and scored " << collector.get_counter("index_docs_scored")
+              << " of " << postings << " postings, "
+              << collector.get_counter("index_positions_decoded")
+              << " position lists" << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "../../inc/query_parser.h"
+#include "../../inc/url_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+QueryParser::QueryParser(const std::string &query, bool match_all)
+    : match_all_(match_all) {
+  int depth = 0;
+  int ignored = 0;
+  size_t i = 0;
+  while (i < query.size() && tokens_.size() < kMaxTokens) {
+    char c = query[i];
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      ++i;
+    } else if (c == '"') {
+      size_t end = std::min(query.find('"', i + 1), query.size());
+      tokens_.push_back(Token{Token::PHRASE, query.substr(i + 1, end - i - 1)});
+      i = end + 1;
+    } else if (c == '(') {
+      if (depth < kMaxDepth) {
+        ++depth;
+        tokens_.push_back(Token{Token::OPEN, ""});
+      } else {
+        ++ignored;
+      }
+      ++i;
+    } else if (c == ')') {
+      if (ignored > 0) {
+        --ignored;
+      } else if (depth > 0) {
+        --depth;
+        tokens_.push_back(Token{Token::CLOSE, ""});
+      }
+      ++i;
+    } else {
+      size_t end =
+          std::min(query.find_first_of(" \t\r\n\"()", i), query.size());
+      tokens_.push_back(Token{Token::WORD, query.substr(i, end - i)});
+      i = end;
+    }
+  }
+}
+
+IndexQuery QueryParser::parse(const std::string &query, bool match_all) {
+  QueryParser parser(query, match_all);
+  IndexQuery parsed;
+  if (!parser.parse_group(parsed))
+    return IndexQuery();
+  return parsed;
+}
+
+bool QueryParser::accept(const char *keyword) {
+  if (pos_ < tokens_.size() && tokens_[pos_].kind == Token::WORD &&
+      tokens_[pos_].text == keyword) {
+    ++pos_;
+    return true;
+  }
+  return false;
+}
+
+bool QueryParser::stop() const {
+  return pos_ >= tokens_.size() || tokens_[pos_].kind == Token::CLOSE;
+}
+
+bool QueryParser::near_operator(uint32_t &distance) const {
+  if (pos_ >= tokens_.size() || tokens_[pos_].kind != Token::WORD)
+    return false;
+  const std::string &word = tokens_[pos_].text;
+  if (word == "NEAR") {
+    distance = kDefaultNearDistance;
+    return true;
+  }
+  if (word.size() <= 5 || word.compare(0, 5, "NEAR/") != 0 ||
+      !std::all_of(word.begin() + 5, word.end(), ::isdigit))
+    return false;
+  distance = static_cast<uint32_t>(std::strtoul(word.c_str() + 5, nullptr, 10));
+  return true;
+}
+
+bool QueryParser::is_operator(const std::string &word) {
+  return word == "AND" || word == "OR" || word == "NOT" || word == "NEAR" ||
+         word.compare(0, 5, "NEAR/") == 0;
+}
+
+void QueryParser::add_child(IndexQuery &parent, IndexQuery child) {
+  if (child.kind == parent.kind &&
+      (child.kind == IndexQuery::AND || child.kind == IndexQuery::OR)) {
+    for (auto &grandchild : child.children)
+      add_child(parent, std::move(grandchild));
+    return;
+  }
+  std::string text = child.to_string();
+  for (const auto &sibling : parent.children) {
+    if (sibling.to_string() == text)
+      return;
+  }
+  parent.children.push_back(std::move(child));
+}
+
+IndexQuery QueryParser::simplify(IndexQuery query) {
+  if ((query.kind == IndexQuery::AND || query.kind == IndexQuery::OR) &&
+      query.children.size() == 1 && query.children[0].kind != IndexQuery::NOT)
+    return std::move(query.children[0]);
+  return query;
+}
+
+// A sequence of expressions up to the end or a closing parenthesis, joined
+// like juxtaposed words. Tokens that start no expression are skipped.
+bool QueryParser::parse_group(IndexQuery &out) {
+  IndexQuery group;
+  group.kind = match_all_ ? IndexQuery::AND : IndexQuery::OR;
+  while (!stop()) {
+    size_t start = pos_;
+    IndexQuery child;
+    if (parse_or(child))
+      add_child(group, std::move(child));
+    if (pos_ == start)
+      ++pos_;
+  }
+  if (group.empty())
+    return false;
+  out = simplify(std::move(group));
+  return true;
+}
+
+bool QueryParser::parse_or(IndexQuery &out) {
+  IndexQuery node;
+  node.kind = IndexQuery::OR;
+  for (;;) {
+    size_t start = pos_;
+    IndexQuery child;
+    if (parse_and(child))
+      add_child(node, std::move(child));
+    if (accept("OR"))
+      continue;
+    if (match_all_ || stop() || pos_ == start)
+      break;
+  }
+  if (node.empty())
+    return false;
+  out = simplify(std::move(node));
+  return true;
+}
+
+// Without match_all, juxtaposed expressions are left to parse_or; explicit
+// AND and NOT still join.
+bool QueryParser::parse_and(IndexQuery &out) {
+  IndexQuery node;
+  node.kind = IndexQuery::AND;
+  for (;;) {
+    size_t start = pos_;
+    bool joined = accept("AND");
+    bool negate = accept("NOT");
+    if (!node.empty() && !joined && !negate && !match_all_)
+      break;
+    IndexQuery child;
+    if (!parse_near(child)) {
+      if (pos_ == start)
+        break;
+      continue;
+    }
+    if (negate) {
+      IndexQuery excluded;
+      excluded.kind = IndexQuery::NOT;
+      excluded.children.push_back(std::move(child));
+      child = std::move(excluded);
+    }
+    add_child(node, std::move(child));
+  }
+  if (node.empty())
+    return false;
+  out = simplify(std::move(node));
+  return true;
+}
+
+// NEAR constrains two phrases; a chain constrains each adjacent pair, and
+// operands that are not phrases are simply ANDed.
+bool QueryParser::parse_near(IndexQuery &out) {
+  IndexQuery left;
+  if (!parse_primary(left))
+    return false;
+
+  IndexQuery joined;
+  joined.kind = IndexQuery::AND;
+  uint32_t distance;
+  while (near_operator(distance)) {
+    ++pos_;
+    IndexQuery right;
+    if (!parse_primary(right))
+      break;
+    if (left.kind == IndexQuery::PHRASE && right.kind == IndexQuery::PHRASE) {
+      IndexQuery near;
+      near.kind = IndexQuery::NEAR;
+      near.distance = distance;
+      near.children = {left, right};
+      add_child(joined, std::move(near));
+    } else {
+      add_child(joined, left);
+      add_child(joined, right);
+    }
+    left = std::move(right);
+  }
+  out = joined.empty() ? std::move(left) : simplify(std::move(joined));
+  return true;
+}
+
+bool QueryParser::parse_primary(IndexQuery &out) {
+  std::vector<std::string> words;
+  while (!stop()) {
+    const Token &token = tokens_[pos_];
+    if (token.kind == Token::WORD && is_operator(token.text))
+      return false;
+    ++pos_;
+
+    if (token.kind == Token::OPEN) {
+      bool found = parse_group(out);
+      if (pos_ < tokens_.size())
+        ++pos_;
+      if (found)
+        return true;
+      continue;
+    }
+
+    if (token.kind == Token::WORD && token.text.compare(0, 5, "site:") == 0) {
+      std::string host = token.text.substr(5);
+      std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+      host = UrlUtils::extract_domain(host);
+      if (host.empty())
+        continue;
+      out = IndexQuery();
+      out.kind = IndexQuery::SITE;
+      out.terms.push_back(host);
+      return true;
+    }
+
+    TermTokenizer::tokenize(token.text, words);
+    if (words.empty())
+      continue;
+    out = IndexQuery();
+    out.kind = IndexQuery::PHRASE;
+    out.terms = words;
+    return true;
+  }
+  return false;
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "../../inc/result_cache.h"
+#include "../../inc/metrics_collector.h"
+#include <algorithm>
+#include <functional>
+
+static const size_t kEntryOverhead = 128;
+static const size_t kAverageEntryBytes = 1024;
+
+static uint64_t mix(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+FrequencySketch::FrequencySketch(size_t expected_entries) {
+  size_t width = 64;
+  while (width < expected_entries)
+    width <<= 1;
+  counters_.assign(width * kDepth, 0);
+  width_mask_ = width - 1;
+  sample_size_ = width * 10;
+}
+
+size_t FrequencySketch::index(uint64_t hash, size_t row) const {
+  return row * (width_mask_ + 1) +
+         (mix(hash + row * 0x9e3779b97f4a7c15ULL) & width_mask_);
+}
+
+void FrequencySketch::increment(uint64_t hash) {
+  for (size_t row = 0; row < kDepth; ++row) {
+    uint8_t &counter = counters_[index(hash, row)];
+    if (counter < 15)
+      ++counter;
+  }
+  if (++additions_ >= sample_size_)
+    halve();
+}
+
+uint32_t FrequencySketch::estimate(uint64_t hash) const {
+  uint32_t count = 15;
+  for (size_t row = 0; row < kDepth; ++row)
+    count = std::min<uint32_t>(count, counters_[index(hash, row)]);
+  return count;
+}
+
+void FrequencySketch::halve() {
+  for (auto &counter : counters_)
+    counter >>= 1;
+  additions_ /= 2;
+}
+
+ResultCache::ResultCache(size_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes),
+      window_capacity_(std::max<size_t>(capacity_bytes / 100, 1)),
+      protected_capacity_((capacity_bytes - window_capacity_) * 8 / 10),
+      sketch_(capacity_bytes / kAverageEntryBytes) {}
+
+ResultCache::EntryList &ResultCache::list(Segment segment) {
+  return segment == WINDOW      ? window_
+         : segment == PROBATION ? probation_
+                                : protected_;
+}
+
+size_t &ResultCache::bytes(Segment segment) {
+  return segment == WINDOW      ? window_bytes_
+         : segment == PROBATION ? probation_bytes_
+                                : protected_bytes_;
+}
+
+void ResultCache::move_to(EntryList::iterator entry, Segment segment) {
+  bytes(entry->segment) -= entry->bytes;
+  bytes(segment) += entry->bytes;
+  list(segment).splice(list(segment).begin(), list(entry->segment), entry);
+  entry->segment = segment;
+}
+
+void ResultCache::evict(EntryList::iterator entry) {
+  bytes(entry->segment) -= entry->bytes;
+  entries_.erase(entry->key);
+  list(entry->segment).erase(entry);
+}
+
+void ResultCache::reset(uint64_t generation) {
+  if (!entries_.empty())
+    MetricsCollector::instance().increment_counter(
+        "search_cache_invalidations");
+  window_.clear();
+  probation_.clear();
+  protected_.clear();
+  entries_.clear();
+  window_bytes_ = probation_bytes_ = protected_bytes_ = 0;
+  generation_ = generation;
+}
+
+bool ResultCache::get(const std::string &key, uint64_t generation,
+                      std::vector<std::string> &results, double &cost_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (generation < generation_)
+    return false;
+  if (generation > generation_)
+    reset(generation);
+
+  uint64_t hash = std::hash<std::string>{}(key);
+  sketch_.increment(hash);
+  auto it = entries_.find(key);
+  if (it == entries_.end())
+    return false;
+
+  EntryList::iterator entry = it->second;
+  if (entry->segment == PROBATION) {
+    move_to(entry, PROTECTED);
+    while (protected_bytes_ > protected_capacity_ && protected_.size() > 1)
+      move_to(std::prev(protected_.end()), PROBATION);
+  } else {
+    move_to(entry, entry->segment);
+  }
+  results = entry->results;
+  cost_ms = entry->cost_ms;
+  return true;
+}
+
+void ResultCache::put(const std::string &key, uint64_t generation,
+                      const std::vector<std::string> &results,
+                      double cost_ms) {
+  size_t size = kEntryOverhead + 2 * key.size();
+  for (const auto &result : results)
+    size += sizeof(std::string) + result.size();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (generation < generation_)
+    return;
+  if (generation > generation_)
+    reset(generation);
+  if (size > window_capacity_ || entries_.count(key))
+    return;
+
+  window_.push_front(Entry{key, std::hash<std::string>{}(key), results,
+                           cost_ms, size, WINDOW});
+  window_bytes_ += size;
+  entries_[key] = window_.begin();
+  while (window_bytes_ > window_capacity_)
+    admit_from_window();
+}
+
+// The window's LRU entry competes with the probation LRU entry for space in
+// the main area; the less frequently requested one is evicted.
+void ResultCache::admit_from_window() {
+  EntryList::iterator candidate = std::prev(window_.end());
+  move_to(candidate, PROBATION);
+
+  size_t main_capacity = capacity_bytes_ - window_capacity_;
+  MetricsCollector &metrics = MetricsCollector::instance();
+  while (probation_bytes_ + protected_bytes_ > main_capacity) {
+    EntryList::iterator victim = std::prev(probation_.end());
+    if (victim == candidate && probation_.size() > 1)
+      victim = std::prev(victim);
+    if (victim == candidate) {
+      move_to(std::prev(protected_.end()), PROBATION);
+      continue;
+    }
+    if (sketch_.estimate(candidate->hash) > sketch_.estimate(victim->hash)) {
+      evict(victim);
+      metrics.increment_counter("search_cache_evictions");
+    } else {
+      evict(candidate);
+      metrics.increment_counter("search_cache_rejections");
+      return;
+    }
+  }
+}
+
+size_t ResultCache::size_bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return window_bytes_ + probation_bytes_ + protected_bytes_;
+}
+
+size_t ResultCache::entry_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
\ No newline at end of file
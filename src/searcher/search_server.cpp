@@ -0,0 +1,416 @@
+#include "../../inc/search_server.h"
+#include "../../inc/metrics_collector.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+static const size_t kMaxRequestBytes = 64 * 1024;
+static const int kPollIntervalMs = 200;
+
+struct SocketAddress {
+  sockaddr_storage storage;
+  socklen_t length = 0;
+  std::string unix_path;
+};
+
+static bool parse_address(const std::string &address, SocketAddress &out) {
+  std::memset(&out.storage, 0, sizeof(out.storage));
+
+  std::string path = address;
+  if (path.rfind("unix:", 0) == 0)
+    path = path.substr(5);
+  if (path.find('/') != std::string::npos) {
+    sockaddr_un *addr = reinterpret_cast<sockaddr_un *>(&out.storage);
+    if (path.size() >= sizeof(addr->sun_path))
+      return false;
+    addr->sun_family = AF_UNIX;
+    std::memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+    out.length = sizeof(sockaddr_un);
+    out.unix_path = path;
+    return true;
+  }
+
+  std::string host = "127.0.0.1";
+  std::string port = address;
+  size_t colon = address.rfind(':');
+  if (colon != std::string::npos) {
+    host = address.substr(0, colon);
+    port = address.substr(colon + 1);
+  }
+  if (host == "localhost")
+    host = "127.0.0.1";
+
+  sockaddr_in *addr = reinterpret_cast<sockaddr_in *>(&out.storage);
+  addr->sin_family = AF_INET;
+  char *end = nullptr;
+  unsigned long number = std::strtoul(port.c_str(), &end, 10);
+  if (port.empty() || *end || number == 0 || number > 65535 ||
+      inet_pton(AF_INET, host.c_str(), &addr->sin_addr) != 1)
+    return false;
+  addr->sin_port = htons(static_cast<uint16_t>(number));
+  out.length = sizeof(sockaddr_in);
+  return true;
+}
+
+static bool send_all(int fd, const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    sent += n;
+  }
+  return true;
+}
+
+static void set_no_delay(int fd) {
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+SearchServer::Connection::~Connection() { close(fd); }
+
+// Writes as much of output as the socket takes; false if the peer is gone.
+// Called with mutex held.
+bool SearchServer::Connection::flush() {
+  size_t sent = 0;
+  while (sent < output.size()) {
+    ssize_t n = send(fd, output.data() + sent, output.size() - sent,
+                     MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if (n <= 0)
+      return false;
+    sent += n;
+  }
+  output.erase(0, sent);
+  return true;
+}
+
+SearchServer::SearchServer(Searcher &searcher, size_t thread_count)
+    : searcher_(searcher),
+      scheduler_(parallel_scheduler_create(std::max<size_t>(1, thread_count))) {
+  if (pipe2(wake_fds_, O_NONBLOCK | O_CLOEXEC) != 0)
+    std::cerr << "Failed to create wake pipe: " << strerror(errno)
+              << std::endl;
+}
+
+SearchServer::~SearchServer() {
+  parallel_scheduler_destroy(scheduler_);
+  for (int fd : wake_fds_) {
+    if (fd >= 0)
+      close(fd);
+  }
+  if (listen_fd_ >= 0)
+    close(listen_fd_);
+  if (!unix_path_.empty())
+    unlink(unix_path_.c_str());
+}
+
+bool SearchServer::listen(const std::string &address) {
+  SocketAddress addr;
+  if (!parse_address(address, addr)) {
+    std::cerr << "Invalid listen address: " << address << std::endl;
+    return false;
+  }
+
+  listen_fd_ = socket(addr.storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
+    return false;
+  }
+  if (addr.unix_path.empty()) {
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  } else {
+    unlink(addr.unix_path.c_str());
+  }
+
+  if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr.storage),
+           addr.length) != 0 ||
+      ::listen(listen_fd_, 128) != 0) {
+    std::cerr << "Failed to listen on " << address << ": " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+  unix_path_ = addr.unix_path;
+  return true;
+}
+
+// Safe to call from a signal handler.
+void SearchServer::stop() {
+  running_ = false;
+  wake();
+}
+
+void SearchServer::wake() {
+  char byte = 0;
+  if (wake_fds_[1] >= 0 && write(wake_fds_[1], &byte, 1) < 0) {
+    // A full pipe already holds a wakeup.
+  }
+}
+
+void SearchServer::run() {
+  running_ = true;
+  std::vector<std::shared_ptr<Connection>> connections;
+  std::vector<pollfd> fds;
+  bool tcp = unix_path_.empty();
+
+  while (running_) {
+    fds.clear();
+    fds.push_back(pollfd{listen_fd_, POLLIN, 0});
+    fds.push_back(pollfd{wake_fds_[0], POLLIN, 0});
+    for (const auto &connection : connections) {
+      short events = 0;
+      std::lock_guard<std::mutex> lock(connection->mutex);
+      if (!connection->read_closed && connection->has_room())
+        events |= POLLIN;
+      if (!connection->output.empty())
+        events |= POLLOUT;
+      fds.push_back(pollfd{connection->fd, events, 0});
+    }
+
+    int ready = poll(fds.data(), fds.size(), kPollIntervalMs);
+    if (ready < 0) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "Search server poll failed: " << strerror(errno)
+                << std::endl;
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char drain[256];
+      while (read(wake_fds_[0], drain, sizeof(drain)) > 0) {
+      }
+    }
+
+    for (size_t i = connections.size(); i-- > 0;) {
+      Connection &connection = *connections[i];
+      short revents = fds[i + 2].revents;
+      bool alive = !(revents & POLLERR);
+      if (alive && (revents & POLLOUT)) {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        alive = connection.flush();
+      }
+      if (alive && (revents & (POLLIN | POLLHUP)))
+        alive = read_requests(connection);
+      if (alive)
+        dispatch_requests(connections[i]);
+
+      bool done = false;
+      if (alive && connection.read_closed) {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        done = connection.in_flight == 0 && connection.output.empty();
+      }
+      if (!alive || done)
+        connections.erase(connections.begin() + i);
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int fd = accept4(listen_fd_, nullptr, nullptr,
+                       SOCK_CLOEXEC | SOCK_NONBLOCK);
+      if (fd >= 0) {
+        if (tcp)
+          set_no_delay(fd);
+        connections.push_back(std::make_shared<Connection>(fd));
+        MetricsCollector::instance().increment_counter("search_connections");
+      }
+    }
+  }
+}
+
+bool SearchServer::read_requests(Connection &connection) {
+  char buffer[16 * 1024];
+  ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+  if (n < 0)
+    return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+  if (n == 0) {
+    connection.read_closed = true;
+    return true;
+  }
+
+  connection.input.append(buffer, n);
+  if (connection.input.size() > kMaxRequestBytes &&
+      connection.input.find('\n') == std::string::npos) {
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    connection.output += "{\"error\":\"request too large\"}\n";
+    connection.input.clear();
+    connection.read_closed = true;
+  }
+  return true;
+}
+
+// Hands complete request lines to the workers while the connection has
+// room; the rest wait in input until replies go out.
+void SearchServer::dispatch_requests(
+    const std::shared_ptr<Connection> &connection) {
+  std::string &input = connection->input;
+  size_t start = 0;
+  for (size_t end; (end = input.find('\n', start)) != std::string::npos;
+       start = end + 1) {
+    size_t length = end - start;
+    if (length && input[end - 1] == '\r')
+      --length;
+    if (!length)
+      continue;
+
+    {
+      std::lock_guard<std::mutex> lock(connection->mutex);
+      if (!connection->has_room())
+        break;
+      ++connection->in_flight;
+    }
+    parallel_scheduler_run(
+        scheduler_, run_query,
+        new QueryTask{this, connection, input.substr(start, length)});
+  }
+  input.erase(0, start);
+}
+
+// Workers never block on a slow client: the reply is sent only as far as
+// the socket takes it, and the poll loop writes the rest.
+void SearchServer::run_query(void *arg) {
+  std::unique_ptr<QueryTask> task(static_cast<QueryTask *>(arg));
+  std::string reply = handle(task->server->searcher_, task->request);
+  reply += '\n';
+
+  Connection &connection = *task->connection;
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    bool was_full = !connection.has_room();
+    --connection.in_flight;
+    bool idle = connection.output.empty();
+    connection.output += reply;
+    if (idle)
+      connection.flush();
+    wake = was_full || !connection.output.empty() ||
+           (connection.in_flight == 0 && connection.read_closed);
+  }
+  if (wake)
+    task->server->wake();
+}
+
+std::string SearchServer::handle(Searcher &searcher,
+                                 const std::string &request) {
+  auto start = std::chrono::steady_clock::now();
+  json reply = json::object();
+  bool ok = false;
+  try {
+    json query = json::parse(request);
+    if (query.contains("id"))
+      reply["id"] = query["id"];
+    if (!query.contains("query") || !query["query"].is_string()) {
+      reply["error"] = "missing \"query\" string";
+    } else {
+      size_t limit = query.value("limit", Searcher::kDefaultLimit);
+      bool any = query.value("any", false);
+      if (limit == 0) {
+        reply["error"] = "\"limit\" must be positive";
+      } else {
+        reply["results"] =
+            searcher.search(query["query"].get<std::string>(), limit, !any);
+        ok = true;
+      }
+    }
+  } catch (const std::exception &e) {
+    reply["error"] = e.what();
+  }
+
+  double took_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  reply["took_ms"] = took_ms;
+  MetricsCollector::instance().record_metric("search_request", took_ms, ok);
+  return reply.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+SearchClient::~SearchClient() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+bool SearchClient::connect(const std::string &address) {
+  SocketAddress addr;
+  if (!parse_address(address, addr)) {
+    std::cerr << "Invalid server address: " << address << std::endl;
+    return false;
+  }
+
+  fd_ = socket(addr.storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0 || ::connect(fd_, reinterpret_cast<sockaddr *>(&addr.storage),
+                           addr.length) != 0) {
+    std::cerr << "Failed to connect to " << address << ": " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+  if (addr.unix_path.empty())
+    set_no_delay(fd_);
+  return true;
+}
+
+bool SearchClient::request(const std::string &line, std::string &reply) {
+  if (fd_ < 0 || !send_all(fd_, line + "\n"))
+    return false;
+
+  size_t end;
+  while ((end = buffer_.find('\n')) == std::string::npos) {
+    char chunk[16 * 1024];
+    ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    buffer_.append(chunk, n);
+  }
+  reply = buffer_.substr(0, end);
+  buffer_.erase(0, end + 1);
+  return true;
+}
+
+bool SearchClient::search(const std::string &query, size_t limit,
+                          bool match_all, std::vector<std::string> &results,
+                          std::string *error) {
+  json request = {{"id", next_id_++},
+                  {"query", query},
+                  {"limit", limit},
+                  {"any", !match_all}};
+  std::string line;
+  if (!this->request(request.dump(-1, ' ', false,
+                                  json::error_handler_t::replace),
+                     line)) {
+    if (error)
+      *error = "connection closed";
+    return false;
+  }
+
+  try {
+    json reply = json::parse(line);
+    if (reply.contains("error")) {
+      if (error)
+        *error = reply["error"].get<std::string>();
+      return false;
+    }
+    results = reply["results"].get<std::vector<std::string>>();
+  } catch (const json::exception &e) {
+    if (error)
+      *error = e.what();
+    return false;
+  }
+  return true;
+}
\ No newline at end of file
@@ -1,10 +1,72 @@
+#include "../../inc/metrics_collector.h"
 #include "../../inc/searcher.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
 
-Searcher::Searcher(char *database) { db.connect(database, SEARCHER); }
+// The generation named by the published MANIFEST, or 0 if there is none.
+static uint64_t manifest_generation(const std::string &index_dir) {
+  uint64_t generation = 0;
+  std::vector<std::string> segments;
+  if (!InvertedIndex::read_manifest(index_dir, generation, segments))
+    return 0;
+  return generation;
+}
+
+Searcher::Searcher(char *database, size_t cache_bytes)
+    : index_dir_(std::string(database) + ".index") {
+  if (cache_bytes)
+    cache_ = std::make_unique<ResultCache>(cache_bytes);
+
+  auto index = std::make_shared<InvertedIndex>();
+  std::string error;
+  has_index_ = index->open(index_dir_, &error);
+  if (has_index_) {
+    index_ = index;
+    manifest_generation_ = index->generation();
+    return;
+  }
+  if (std::filesystem::exists(index_dir_))
+    std::cerr << error << "; falling back to SQLite" << std::endl;
+
+  db.connect(database, SEARCHER);
+  has_fts_ = db.has_table("pages_fts");
+}
 
 Searcher::~Searcher() {}
 
-std::vector<std::string> Searcher::search(const std::string &query) {
+// The index generation changes when indexer publishes a MANIFEST naming a
+// new generation, which is then loaded in place of the old index; without
+// an index, SQLite's data_version changes whenever the crawler commits,
+// possibly adding dictionaries that later pages need.
+uint64_t Searcher::generation() {
+  if (!has_index_) {
+    long long version = db.data_version();
+    db.refresh_dictionaries(version);
+    return version;
+  }
+
+  uint64_t published = manifest_generation(index_dir_);
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  if (published && published != manifest_generation_) {
+    manifest_generation_ = published;
+    auto index = std::make_shared<InvertedIndex>();
+    std::string error;
+    if (index->open(index_dir_, &error)) {
+      index_ = index;
+      manifest_generation_ = index->generation();
+      MetricsCollector::instance().increment_counter("search_index_reloads");
+    } else {
+      std::cerr << error << "; keeping index generation "
+                << index_->generation() << std::endl;
+    }
+  }
+  return index_->generation();
+}
+
+std::vector<std::string> Searcher::search(const std::string &query,
+                                          size_t limit, bool match_all) {
   std::vector<std::string> results;
 
   if (query.empty()) {
@@ -12,8 +74,179 @@ std::vector<std::string> Searcher::search(const std::string &query) {
     return results;
   }
 
+  MetricsCollector &metrics = MetricsCollector::instance();
+  uint64_t current = generation();
+  bool parsed_search = has_index_ || has_fts_;
+  IndexQuery parsed;
+  if (parsed_search)
+    parsed = QueryParser::parse(query, match_all);
+
+  std::string key;
+  if (cache_) {
+    key = parsed_search ? parsed.to_string() : query;
+    key += '\0';
+    key += std::to_string(limit);
+    double cost_ms = 0;
+    if (cache_->get(key, current, results, cost_ms)) {
+      metrics.increment_counter("search_cache_hits");
+      metrics.record_metric("search_cache_saved", cost_ms);
+      return results;
+    }
+    metrics.increment_counter("search_cache_misses");
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if (has_index_)
+    results = search_index(parsed, limit);
+  else if (has_fts_)
+    results = search_fts(parsed, limit);
+  else
+    results = search_like(query, limit);
+
+  if (cache_) {
+    double cost_ms = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    cache_->put(key, current, results, cost_ms);
+  }
+  return results;
+}
+
+std::vector<std::string> Searcher::search_index(const IndexQuery &query,
+                                                size_t limit) {
+  std::shared_ptr<const InvertedIndex> index;
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    index = index_;
+  }
+
+  IndexQueryStats stats;
+  std::vector<std::string> results;
+  for (const auto &hit : index->search(query, limit, &stats))
+    results.push_back(index->url(hit));
+
+  MetricsCollector &metrics = MetricsCollector::instance();
+  metrics.increment_counter("index_postings", stats.postings);
+  metrics.increment_counter("index_postings_decoded", stats.decoded);
+  metrics.increment_counter("index_docs_scored", stats.scored);
+  metrics.increment_counter("index_positions_decoded", stats.positions);
+  return results;
+}
+
+// Translates a query to FTS5 syntax. SQLite can only apply site: as a
+// filter on the whole result, so sites are collected from the top-level
+// conjunction and rejected anywhere else.
+bool Searcher::fts_match(const IndexQuery &query, bool top_level,
+                         std::string &match, std::vector<std::string> &sites) {
+  match.clear();
+  switch (query.kind) {
+  case IndexQuery::PHRASE:
+  case IndexQuery::NEAR:
+    match = query.to_string();
+    return true;
+  case IndexQuery::SITE:
+    if (!top_level)
+      return false;
+    sites.push_back(query.terms[0]);
+    return true;
+  case IndexQuery::NOT:
+    return true;
+  case IndexQuery::AND:
+  case IndexQuery::OR:
+    break;
+  }
+
+  std::string excluded;
+  for (const auto &child : query.children) {
+    std::string part;
+    bool negated = child.kind == IndexQuery::NOT;
+    if (negated && query.kind == IndexQuery::AND &&
+        !child.children.empty()) {
+      if (!fts_match(child.children[0], false, part, sites))
+        return false;
+      if (!part.empty())
+        excluded += " NOT " + part;
+      continue;
+    }
+    if (!fts_match(child, top_level && query.kind == IndexQuery::AND, part,
+                   sites))
+      return false;
+    if (part.empty())
+      continue;
+    if (!match.empty())
+      match += query.kind == IndexQuery::AND ? " AND " : " OR ";
+    match += part;
+  }
+  if (!match.empty())
+    match = "(" + match + excluded + ")";
+  return true;
+}
+
+std::vector<std::string> Searcher::search_fts(const IndexQuery &query,
+                                              size_t limit) {
+  std::vector<std::string> results;
+  std::string match;
+  std::vector<std::string> sites;
+  if (!fts_match(query, true, match, sites)) {
+    std::cerr << "site: can only restrict the whole query without a native "
+                 "index"
+              << std::endl;
+    return results;
+  }
+  if (match.empty() && sites.empty())
+    return results;
+
+  std::string sql = match.empty()
+                        ? "SELECT url FROM pages WHERE 1"
+                        : "SELECT pages.url FROM pages_fts "
+                          "JOIN pages ON pages.id = pages_fts.rowid "
+                          "WHERE pages_fts MATCH ?";
+  for (size_t i = 0; i < sites.size(); ++i)
+    sql += " AND url_site(url, ?)";
+  sql += match.empty() ? " LIMIT ?;" : " ORDER BY bm25(pages_fts) LIMIT ?;";
+
   sqlite3_stmt *stmt;
-  std::string sql = "SELECT url FROM pages WHERE content LIKE ?;";
+  if (sqlite3_prepare_v2(db.get_db(), sql.c_str(), -1, &stmt, nullptr) !=
+      SQLITE_OK) {
+    std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db.get_db())
+              << "\n";
+    return results;
+  }
+
+  int index = 1;
+  bool bound = match.empty() ||
+               sqlite3_bind_text(stmt, index++, match.c_str(), -1,
+                                 SQLITE_STATIC) == SQLITE_OK;
+  for (const auto &site : sites)
+    bound = bound && sqlite3_bind_text(stmt, index++, site.c_str(), -1,
+                                       SQLITE_STATIC) == SQLITE_OK;
+  if (!bound || sqlite3_bind_int64(stmt, index, limit) != SQLITE_OK) {
+    std::cerr << "Failed to bind query: " << sqlite3_errmsg(db.get_db())
+              << "\n";
+    sqlite3_finalize(stmt);
+    return results;
+  }
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char *url =
+        reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    if (url) {
+      results.push_back(url);
+    }
+  }
+
+  sqlite3_finalize(stmt);
+  return results;
+}
+
+std::vector<std::string> Searcher::search_like(const std::string &query,
+                                               size_t limit) {
+  std::vector<std::string> results;
+
+  sqlite3_stmt *stmt;
+  std::string sql = "SELECT url FROM pages "
+                    "WHERE page_text(content, content_zstd, dict_id) LIKE ? "
+                    "LIMIT ?;";
   if (sqlite3_prepare_v2(db.get_db(), sql.c_str(), -1, &stmt, nullptr) !=
       SQLITE_OK) {
     std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db.get_db())
@@ -23,7 +256,8 @@ std::vector<std::string> Searcher::search(const std::string &query) {
 
   std::string like_query = "%" + query + "%";
   if (sqlite3_bind_text(stmt, 1, like_query.c_str(), -1, SQLITE_STATIC) !=
-      SQLITE_OK) {
+          SQLITE_OK ||
+      sqlite3_bind_int64(stmt, 2, limit) != SQLITE_OK) {
     std::cerr << "Failed to bind query: " << sqlite3_errmsg(db.get_db())
               << "\n";
     sqlite3_finalize(stmt);
@@ -0,0 +1,242 @@
+#include "../../inc/sitemap_parser.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <zlib.h>
+
+static const size_t MAX_MARKUP_SIZE = 4096;
+static const size_t MAX_TEXT_SIZE = 8192;
+static const size_t INFLATE_CHUNK_SIZE = 16384;
+
+struct SitemapParser::Inflater {
+  z_stream stream{};
+  bool done = false;
+
+  Inflater() { inflateInit2(&stream, 16 + MAX_WBITS); }
+  ~Inflater() { inflateEnd(&stream); }
+};
+
+SitemapParser::SitemapParser(EntryCallback callback)
+    : callback_(std::move(callback)) {}
+
+SitemapParser::~SitemapParser() = default;
+
+bool SitemapParser::feed(const char *data, size_t size) {
+  if (failed_ || size == 0)
+    return !failed_;
+
+  if (!format_detected_) {
+    format_detected_ = true;
+    if (size >= 2 && static_cast<unsigned char>(data[0]) == 0x1f &&
+        static_cast<unsigned char>(data[1]) == 0x8b) {
+      inflater_ = std::make_unique<Inflater>();
+    }
+  }
+
+  if (inflater_)
+    return inflate_chunk(data, size);
+
+  scan(data, size);
+  return true;
+}
+
+bool SitemapParser::finish() {
+  if (inflater_ && !inflater_->done)
+    failed_ = true;
+  return !failed_;
+}
+
+bool SitemapParser::inflate_chunk(const char *data, size_t size) {
+  if (inflater_->done)
+    return true;
+
+  char out[INFLATE_CHUNK_SIZE];
+  z_stream &stream = inflater_->stream;
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  stream.avail_in = static_cast<uInt>(size);
+
+  while (stream.avail_in > 0) {
+    stream.next_out = reinterpret_cast<Bytef *>(out);
+    stream.avail_out = sizeof(out);
+
+    int result = inflate(&stream, Z_NO_FLUSH);
+    if (result != Z_OK && result != Z_STREAM_END) {
+      failed_ = true;
+      return false;
+    }
+
+    scan(out, sizeof(out) - stream.avail_out);
+
+    if (result == Z_STREAM_END) {
+      inflater_->done = true;
+      break;
+    }
+  }
+  return true;
+}
+
+void SitemapParser::scan(const char *data, size_t size) {
+  const char *p = data;
+  const char *end = data + size;
+
+  while (p < end) {
+    if (in_markup_) {
+      const char *close = static_cast<const char *>(memchr(p, '>', end - p));
+      const char *stop = close ? close : end;
+      if (markup_.size() < MAX_MARKUP_SIZE)
+        markup_.append(p, std::min<size_t>(stop - p,
+                                           MAX_MARKUP_SIZE - markup_.size()));
+      if (!close)
+        return;
+      p = close + 1;
+      handle_markup();
+      continue;
+    }
+
+    const char *open = static_cast<const char *>(memchr(p, '<', end - p));
+    const char *stop = open ? open : end;
+    if (field_ != Field::NONE && text_.size() < MAX_TEXT_SIZE)
+      text_.append(p, std::min<size_t>(stop - p, MAX_TEXT_SIZE - text_.size()));
+    if (!open)
+      return;
+    p = open + 1;
+    in_markup_ = true;
+    markup_.clear();
+  }
+}
+
+static std::string local_name(const std::string &markup, size_t start) {
+  size_t end = markup.find_first_of(" \t\r\n/", start);
+  std::string name = markup.substr(
+      start, end == std::string::npos ? std::string::npos : end - start);
+  size_t colon = name.find(':');
+  return colon == std::string::npos ? name : name.substr(colon + 1);
+}
+
+void SitemapParser::handle_markup() {
+  // Comments and CDATA sections may contain '>' before their terminator.
+  bool truncated = markup_.size() >= MAX_MARKUP_SIZE;
+  if (markup_.compare(0, 3, "!--") == 0) {
+    if (!truncated && (markup_.size() < 5 ||
+                       markup_.compare(markup_.size() - 2, 2, "--") != 0)) {
+      markup_ += '>';
+      return;
+    }
+  } else if (markup_.compare(0, 8, "![CDATA[") == 0) {
+    if (!truncated && (markup_.size() < 10 ||
+                       markup_.compare(markup_.size() - 2, 2, "]]") != 0)) {
+      markup_ += '>';
+      return;
+    }
+    if (!truncated && field_ != Field::NONE)
+      text_.append(markup_, 8, markup_.size() - 10);
+  } else if (!markup_.empty() && markup_[0] == '/') {
+    end_element(local_name(markup_, 1));
+  } else if (!markup_.empty() && markup_[0] != '?' && markup_[0] != '!') {
+    start_element(local_name(markup_, 0));
+  }
+
+  in_markup_ = false;
+  markup_.clear();
+}
+
+void SitemapParser::start_element(const std::string &name) {
+  if (name == "url" || name == "sitemap") {
+    in_entry_ = true;
+    entry_ = SitemapEntry();
+    entry_.is_sitemap = name == "sitemap";
+  } else if (in_entry_ && name == "loc") {
+    field_ = Field::LOC;
+  } else if (in_entry_ && name == "lastmod") {
+    field_ = Field::LASTMOD;
+  } else if (in_entry_ && name == "priority") {
+    field_ = Field::PRIORITY;
+  } else {
+    return;
+  }
+  text_.clear();
+}
+
+static std::string decode_entities(const std::string &value) {
+  static const struct {
+    const char *entity;
+    char replacement;
+  } entities[] = {{"&amp;", '&'},
+                  {"&lt;", '<'},
+                  {"&gt;", '>'},
+                  {"&quot;", '"'},
+                  {"&apos;", '\''}};
+
+  std::string result;
+  result.reserve(value.size());
+  for (size_t i = 0; i < value.size(); ++i) {
+    bool replaced = false;
+    if (value[i] == '&') {
+      for (const auto &entity : entities) {
+        size_t length = strlen(entity.entity);
+        if (value.compare(i, length, entity.entity) == 0) {
+          result += entity.replacement;
+          i += length - 1;
+          replaced = true;
+          break;
+        }
+      }
+    }
+    if (!replaced)
+      result += value[i];
+  }
+  return result;
+}
+
+static std::string trim(const std::string &value) {
+  size_t first = value.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos)
+    return "";
+  size_t last = value.find_last_not_of(" \t\r\n");
+  return value.substr(first, last - first + 1);
+}
+
+void SitemapParser::end_element(const std::string &name) {
+  if (!in_entry_)
+    return;
+
+  if (name == "loc" && field_ == Field::LOC) {
+    entry_.loc = decode_entities(trim(text_));
+  } else if (name == "lastmod" && field_ == Field::LASTMOD) {
+    entry_.lastmod = parse_lastmod(trim(text_));
+  } else if (name == "priority" && field_ == Field::PRIORITY) {
+    char *parse_end = nullptr;
+    std::string value = trim(text_);
+    double priority = std::strtod(value.c_str(), &parse_end);
+    if (parse_end != value.c_str() && priority >= 0.0 && priority <= 1.0)
+      entry_.priority = priority;
+  } else if (name == "url" || name == "sitemap") {
+    in_entry_ = false;
+    if (!entry_.loc.empty()) {
+      ++entry_count_;
+      callback_(entry_);
+    }
+  }
+
+  field_ = Field::NONE;
+  text_.clear();
+}
+
+long long SitemapParser::parse_lastmod(const std::string &value) {
+  struct tm time = {};
+  int year = 0, month = 1, day = 1, hour = 0, minute = 0, second = 0;
+  int fields = sscanf(value.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d", &year, &month,
+                      &day, &hour, &minute, &second);
+  if (fields < 1 || year < 1970)
+    return 0;
+
+  time.tm_year = year - 1900;
+  time.tm_mon = month - 1;
+  time.tm_mday = day;
+  time.tm_hour = hour;
+  time.tm_min = minute;
+  time.tm_sec = second;
+  return static_cast<long long>(timegm(&time));
+}
\ No newline at end of file
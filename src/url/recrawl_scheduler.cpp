@@ -0,0 +1,122 @@
+#include "../../inc/recrawl_scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+static const long long SECONDS_PER_HOUR = 3600;
+static const long long SECONDS_PER_DAY = 24 * SECONDS_PER_HOUR;
+
+// Cho & Garcia-Molina estimator for a Poisson process observed only as
+// "changed / not changed" between visits: n intervals with X detected
+// changes give rate = -ln((n - X + 0.5) / (n + 0.5)) / mean_interval.
+double RecrawlScheduler::estimate_change_rate(
+    const PageHistorySummary &history) const {
+  if (history.visits < 2 || history.last_fetched <= history.first_fetched) {
+    return default_change_rate();
+  }
+
+  double intervals = static_cast<double>(history.visits - 1);
+  double changes = std::min(static_cast<double>(history.changes), intervals);
+  double mean_interval =
+      (history.last_fetched - history.first_fetched) / intervals;
+
+  return -std::log((intervals - changes + 0.5) / (intervals + 0.5)) /
+         mean_interval;
+}
+
+double RecrawlScheduler::default_change_rate() const {
+  return 1.0 / (config_.recrawl_default_interval_hours * SECONDS_PER_HOUR);
+}
+
+long long RecrawlScheduler::revisit_interval(double change_rate) const {
+  long long min_interval = static_cast<long long>(
+      config_.recrawl_min_interval_hours * SECONDS_PER_HOUR);
+  long long max_interval = static_cast<long long>(
+      config_.recrawl_max_interval_hours * SECONDS_PER_HOUR);
+  if (change_rate <= 0) {
+    return max_interval;
+  }
+
+  double interval =
+      -std::log(1.0 - config_.recrawl_target_change_probability) /
+      change_rate;
+  return std::clamp(static_cast<long long>(interval), min_interval,
+                    max_interval);
+}
+
+double RecrawlScheduler::change_probability(double change_rate,
+                                            long long elapsed) const {
+  double min_rate =
+      1.0 / (config_.recrawl_max_interval_hours * SECONDS_PER_HOUR);
+  return 1.0 - std::exp(-std::max(change_rate, min_rate) *
+                        static_cast<double>(elapsed));
+}
+
+RevisitPlan RecrawlScheduler::next_plan(const std::string &url,
+                                        double change_rate,
+                                        long long fetched_at) const {
+  RevisitPlan plan;
+  plan.url = url;
+  plan.change_rate = change_rate;
+  plan.last_fetched = fetched_at;
+  plan.next_visit = fetched_at + revisit_interval(change_rate);
+  return plan;
+}
+
+size_t RecrawlScheduler::budget_left(long long now) const {
+  if (config_.recrawl_daily_budget == 0) {
+    return SIZE_MAX;
+  }
+  size_t spent = db_.count_fetches_since(now - SECONDS_PER_DAY);
+  return spent < config_.recrawl_daily_budget
+             ? config_.recrawl_daily_budget - spent
+             : 0;
+}
+
+std::vector<RevisitPlan> RecrawlScheduler::plan(
+    long long now, size_t *deferred, std::vector<RevisitPlan> *upcoming) {
+  std::vector<RevisitPlan> due;
+  size_t not_due = 0;
+
+  for (const auto &history : db_.get_history_summaries()) {
+    RevisitPlan plan = next_plan(history.url, estimate_change_rate(history),
+                                 history.last_fetched);
+
+    if (plan.next_visit > now) {
+      ++not_due;
+      if (upcoming) {
+        upcoming->push_back(plan);
+      }
+      continue;
+    }
+
+    plan.change_probability =
+        change_probability(plan.change_rate, now - history.last_fetched);
+    due.push_back(plan);
+  }
+
+  std::sort(due.begin(), due.end(),
+            [](const RevisitPlan &a, const RevisitPlan &b) {
+              return a.change_probability > b.change_probability;
+            });
+
+  size_t remaining = budget_left(now);
+  if (due.size() > remaining) {
+    not_due += due.size() - remaining;
+    due.resize(remaining);
+  }
+
+  if (deferred) {
+    *deferred = not_due;
+  }
+  return due;
+}
+
+uint64_t RecrawlScheduler::content_hash(const std::string &text) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "../../inc/seed_loader.h"
+#include "../../inc/url_utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <zlib.h>
+
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+SeedLoader::SeedLoader(size_t thread_count)
+    : thread_count_(thread_count ? thread_count : 1) {}
+
+bool SeedLoader::load(const std::string &filename,
+                      std::vector<std::string> &urls) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error: Unable to open seed file " << filename << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    std::cerr << "Error: Unable to stat seed file " << filename << std::endl;
+    close(fd);
+    return false;
+  }
+
+  size_t size = static_cast<size_t>(st.st_size);
+  if (size == 0) {
+    close(fd);
+    return true;
+  }
+
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Error: Unable to map seed file " << filename << std::endl;
+    return false;
+  }
+  madvise(mapping, size, MADV_SEQUENTIAL);
+
+  const char *data = static_cast<const char *>(mapping);
+  bool ok = true;
+
+  if (size >= 2 && static_cast<unsigned char>(data[0]) == 0x1f &&
+      static_cast<unsigned char>(data[1]) == 0x8b) {
+    std::string inflated;
+    ok = read_gzip(data, size, inflated);
+    munmap(mapping, size);
+    if (ok) {
+      parse(inflated.data(), inflated.size(), urls);
+    } else {
+      std::cerr << "Error: Corrupt gzip seed file " << filename << std::endl;
+    }
+    return ok;
+  }
+
+  parse(data, size, urls);
+  munmap(mapping, size);
+  return ok;
+}
+
+bool SeedLoader::read_gzip(const char *data, size_t size,
+                           std::string &output) {
+  z_stream stream{};
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    return false;
+
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  stream.avail_in = static_cast<uInt>(size);
+  output.resize(size * 4);
+
+  int result = Z_OK;
+  while (result != Z_STREAM_END) {
+    if (stream.total_out == output.size())
+      output.resize(output.size() * 2);
+
+    stream.next_out = reinterpret_cast<Bytef *>(&output[stream.total_out]);
+    stream.avail_out = static_cast<uInt>(output.size() - stream.total_out);
+
+    result = inflate(&stream, Z_NO_FLUSH);
+    if (result == Z_STREAM_END && stream.avail_in > 0) {
+      // Concatenated gzip members, as produced by `cat a.gz b.gz`.
+      inflateReset(&stream);
+      result = Z_OK;
+    } else if (result != Z_OK && result != Z_STREAM_END) {
+      inflateEnd(&stream);
+      return false;
+    }
+  }
+
+  output.resize(stream.total_out);
+  inflateEnd(&stream);
+  return true;
+}
+
+void SeedLoader::parse(const char *data, size_t size,
+                       std::vector<std::string> &urls) {
+  size_t threads = std::min(thread_count_, size / MIN_CHUNK_SIZE + 1);
+
+  std::vector<size_t> bounds{0};
+  for (size_t i = 1; i < threads; ++i) {
+    size_t pos = std::max(bounds.back(), size * i / threads);
+    const void *newline = memchr(data + pos, '\n', size - pos);
+    pos = newline ? static_cast<const char *>(newline) - data + 1 : size;
+    bounds.push_back(pos);
+  }
+  bounds.push_back(size);
+  threads = bounds.size() - 1;
+
+  // Each worker normalizes its chunk and scatters URLs into per-shard
+  // buckets by hash, so every shard can then be deduplicated independently.
+  std::vector<std::vector<std::vector<std::string>>> buckets(
+      threads, std::vector<std::vector<std::string>>(threads));
+  std::atomic<size_t> lines{0};
+  std::vector<std::thread> workers;
+
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      std::hash<std::string> hasher;
+      const char *p = data + bounds[t];
+      const char *end = data + bounds[t + 1];
+      size_t count = 0;
+
+      while (p < end) {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        const char *line_end = eol ? eol : end;
+        const char *q = line_end;
+        while (q > p && (q[-1] == '\r' || q[-1] == ' ' || q[-1] == '\t'))
+          --q;
+        while (p < q && (*p == ' ' || *p == '\t'))
+          ++p;
+
+        if (p < q) {
+          ++count;
+          std::string url = UrlUtils::normalize_url(std::string(p, q));
+          buckets[t][hasher(url) % threads].push_back(std::move(url));
+        }
+        p = line_end + 1;
+      }
+      lines += count;
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
+  workers.clear();
+
+  std::vector<std::vector<std::string>> shards(threads);
+  for (size_t s = 0; s < threads; ++s) {
+    workers.emplace_back([&, s]() {
+      size_t total = 0;
+      for (size_t t = 0; t < threads; ++t)
+        total += buckets[t][s].size();
+
+      std::unordered_set<std::string> seen;
+      seen.reserve(total);
+      for (size_t t = 0; t < threads; ++t) {
+        for (auto &url : buckets[t][s]) {
+          if (seen.insert(url).second)
+            shards[s].push_back(std::move(url));
+        }
+        std::vector<std::string>().swap(buckets[t][s]);
+      }
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
+
+  size_t total = urls.size();
+  for (const auto &shard : shards)
+    total += shard.size();
+  urls.reserve(total);
+  for (auto &shard : shards) {
+    std::move(shard.begin(), shard.end(), std::back_inserter(urls));
+  }
+
+  lines_read_ += lines;
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "../../inc/trap_detector.h"
+#include "../../inc/url_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <vector>
+
+static std::vector<std::string> split(const std::string &value, char delimiter,
+                                      size_t begin, size_t end) {
+  std::vector<std::string> parts;
+  while (begin < end) {
+    size_t next = value.find(delimiter, begin);
+    if (next == std::string::npos || next > end)
+      next = end;
+    if (next > begin)
+      parts.push_back(value.substr(begin, next - begin));
+    begin = next + 1;
+  }
+  return parts;
+}
+
+static std::string segment_class(const std::string &segment) {
+  bool digits = true;
+  bool hex = segment.size() >= 8;
+  bool has_digit = false;
+  bool date = true;
+
+  for (unsigned char c : segment) {
+    bool is_digit = std::isdigit(c);
+    has_digit |= is_digit;
+    digits &= is_digit;
+    hex &= std::isxdigit(c) != 0;
+    date &= is_digit || c == '-' || c == '_';
+  }
+
+  if (digits)
+    return "{n}";
+  if (date && has_digit)
+    return "{d}";
+  if (hex && has_digit)
+    return "{h}";
+  return segment;
+}
+
+std::string TrapDetector::path_template(const std::string &url) {
+  size_t path_start = url.find("://");
+  path_start = url.find('/', path_start == std::string::npos ? 0
+                                                             : path_start + 3);
+  size_t query_start = url.find('?');
+  size_t path_end = query_start == std::string::npos ? url.size() : query_start;
+
+  std::string result = UrlUtils::extract_domain(url);
+  if (path_start != std::string::npos && path_start < path_end) {
+    for (const auto &segment : split(url, '/', path_start + 1, path_end)) {
+      result += "/" + segment_class(segment);
+    }
+  }
+
+  if (query_start != std::string::npos) {
+    std::vector<std::string> names;
+    for (const auto &param : split(url, '&', query_start + 1, url.size())) {
+      names.push_back(param.substr(0, param.find('=')));
+    }
+    std::sort(names.begin(), names.end());
+    result += "?";
+    for (const auto &name : names) {
+      result += name + "&";
+    }
+  }
+
+  return result;
+}
+
+bool TrapDetector::admit(const std::string &url, std::string *reason) {
+  auto reject = [reason](const char *why) {
+    if (reason)
+      *reason = why;
+    return false;
+  };
+
+  if (config_.trap_max_url_length > 0 &&
+      url.size() > config_.trap_max_url_length) {
+    return reject("url_length");
+  }
+
+  size_t path_start = url.find("://");
+  path_start = url.find('/', path_start == std::string::npos ? 0
+                                                             : path_start + 3);
+  size_t query_start = url.find('?');
+  size_t path_end = query_start == std::string::npos ? url.size() : query_start;
+
+  std::vector<std::string> segments;
+  if (path_start != std::string::npos && path_start < path_end) {
+    segments = split(url, '/', path_start + 1, path_end);
+  }
+
+  if (config_.trap_max_path_depth > 0 &&
+      segments.size() > config_.trap_max_path_depth) {
+    return reject("path_depth");
+  }
+
+  if (config_.trap_max_repeated_segments > 0) {
+    std::unordered_map<std::string, size_t> occurrences;
+    for (const auto &segment : segments) {
+      if (++occurrences[segment] > config_.trap_max_repeated_segments)
+        return reject("repeated_segment");
+    }
+  }
+
+  std::string pattern = path_template(url);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (config_.trap_max_param_values > 0 && query_start != std::string::npos) {
+    for (const auto &param : split(url, '&', query_start + 1, url.size())) {
+      size_t equals = param.find('=');
+      if (equals == std::string::npos)
+        continue;
+
+      auto &values = param_values_[pattern + "#" + param.substr(0, equals)];
+      size_t value_hash = std::hash<std::string>()(param.substr(equals + 1));
+      if (values.count(value_hash))
+        continue;
+      if (values.size() >= config_.trap_max_param_values)
+        return reject("param_cardinality");
+      values.insert(value_hash);
+    }
+  }
+
+  if (config_.trap_max_urls_per_template > 0 &&
+      ++template_counts_[pattern] > config_.trap_max_urls_per_template) {
+    return reject("template_budget");
+  }
+
+  return true;
+}
\ No newline at end of file
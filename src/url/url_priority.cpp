@@ -1,5 +1,6 @@
 #include "../../inc/url_priority.h"
 #include "../../inc/url_utils.h"
+#include <cmath>
 #include <cstring>
 #include <unordered_map>
 
@@ -24,6 +25,22 @@ double UrlPrioritizer::calculate_priority(const std::string &url, int depth,
   return priority;
 }
 
+double UrlPrioritizer::calculate_sitemap_priority(const std::string &url,
+                                                  const SitemapEntry &entry,
+                                                  long long now) {
+  double priority = calculate_priority(url, 1);
+
+  priority += config_.sitemap_priority_weight *
+              (entry.priority >= 0 ? entry.priority : 0.5);
+
+  if (entry.lastmod > 0 && entry.lastmod <= now) {
+    double age_days = (now - entry.lastmod) / 86400.0;
+    priority += config_.sitemap_freshness_weight * std::exp(-age_days / 30.0);
+  }
+
+  return priority;
+}
+
 double UrlPrioritizer::keyword_score(const std::string &url) {
   double score = 1.0; 
 
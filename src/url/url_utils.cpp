@@ -1,4 +1,20 @@
 #include "../../inc/url_utils.h"
+#include <unordered_set>
+
+static std::vector<std::string> strip_param_rules;
+static bool sort_query_params = false;
+
+static bool matches_strip_rule(const std::string &name) {
+  for (const auto &rule : strip_param_rules) {
+    if (!rule.empty() && rule.back() == '*') {
+      if (name.compare(0, rule.size() - 1, rule, 0, rule.size() - 1) == 0)
+        return true;
+    } else if (name == rule) {
+      return true;
+    }
+  }
+  return false;
+}
 
 std::string UrlUtils::normalize_url(const std::string &url) {
   std::string normalized = url;
@@ -28,6 +44,8 @@ std::string UrlUtils::normalize_url(const std::string &url) {
     normalized = normalized.substr(0, fragment_pos);
   }
 
+  normalized = canonicalize_query(normalized);
+
   if (normalized.size() > 8 && normalized.back() == '/' &&
       std::count(normalized.begin() + 8, normalized.end(), '/') == 1) {
     normalized.pop_back();
@@ -47,11 +65,15 @@ std::string UrlUtils::normalize_url(const std::string &url) {
     }
   }
 
-  std::string result;
+  size_t authority_start = normalized.find("://");
+  authority_start =
+      authority_start == std::string::npos ? 0 : authority_start + 3;
+
+  std::string result = normalized.substr(0, authority_start);
   result.reserve(normalized.size());
   bool prev_was_slash = false;
 
-  for (char c : normalized) {
+  for (char c : normalized.substr(authority_start)) {
     if (c == '/') {
       if (!prev_was_slash) {
         result.push_back(c);
@@ -167,4 +189,108 @@ bool UrlUtils::is_same_domain(const std::string &url,
           (url_domain.size() > domain.size() &&
            url_domain.substr(url_domain.size() - domain.size()) == domain &&
            url_domain[url_domain.size() - domain.size() - 1] == '.'));
+}
+
+bool UrlUtils::has_binary_extension(const std::string &url) {
+  static const std::unordered_set<std::string> binary_extensions = {
+      "7z",   "avi",  "bin",  "bmp",  "bz2", "css",  "dmg",  "doc",
+      "docx", "eot",  "exe",  "flac", "gif", "gz",   "ico",  "iso",
+      "jar",  "jpeg", "jpg",  "js",   "json", "m4a", "mkv",  "mov",
+      "mp3",  "mp4",  "mpeg", "ogg",  "otf", "pdf",  "png",  "ppt",
+      "pptx", "rar",  "svg",  "tar",  "tgz", "tif",  "tiff", "ttf",
+      "wav",  "webm", "webp", "woff", "woff2", "xls", "xlsx", "xz",
+      "zip"};
+
+  size_t path_start = url.find("://");
+  path_start = url.find('/', path_start == std::string::npos ? 0
+                                                             : path_start + 3);
+  if (path_start == std::string::npos) {
+    return false;
+  }
+
+  size_t path_end = url.find_first_of("?#", path_start);
+  if (path_end == std::string::npos) {
+    path_end = url.size();
+  }
+
+  size_t dot = url.find_last_of("./", path_end - 1);
+  if (dot == std::string::npos || dot < path_start || url[dot] != '.') {
+    return false;
+  }
+
+  std::string extension = url.substr(dot + 1, path_end - dot - 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return binary_extensions.count(extension) > 0;
+}
+
+void UrlUtils::set_query_rules(const std::vector<std::string> &strip_params,
+                               bool sort_params) {
+  strip_param_rules.clear();
+  for (auto rule : strip_params) {
+    std::transform(rule.begin(), rule.end(), rule.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    strip_param_rules.push_back(rule);
+  }
+  sort_query_params = sort_params;
+}
+
+std::string UrlUtils::canonicalize_query(const std::string &url) {
+  if (strip_param_rules.empty() && !sort_query_params) {
+    return url;
+  }
+
+  size_t query_pos = url.find('?');
+  std::string path = url.substr(0, query_pos);
+
+  // Each ";name=value" path parameter ends at the next ';' or '/', so
+  // "/a;jsessionid=X/b" keeps its "/b" and every parameter is checked.
+  size_t semicolon = path.find(';');
+  while (semicolon != std::string::npos) {
+    size_t param_end = path.find_first_of(";/", semicolon + 1);
+    if (param_end == std::string::npos)
+      param_end = path.size();
+
+    std::string param = path.substr(semicolon + 1, param_end - semicolon - 1);
+    if (matches_strip_rule(param.substr(0, param.find('=')))) {
+      path.erase(semicolon, param_end - semicolon);
+      semicolon = path.find(';', semicolon);
+    } else {
+      semicolon = path.find(';', param_end);
+    }
+  }
+
+  if (query_pos == std::string::npos) {
+    return path;
+  }
+
+  std::vector<std::string> params;
+  size_t start = query_pos + 1;
+  while (start <= url.size()) {
+    size_t end = url.find('&', start);
+    if (end == std::string::npos)
+      end = url.size();
+
+    std::string param = url.substr(start, end - start);
+    if (!param.empty() &&
+        !matches_strip_rule(param.substr(0, param.find('='))))
+      params.push_back(param);
+    start = end + 1;
+  }
+
+  if (sort_query_params) {
+    std::sort(params.begin(), params.end());
+  }
+
+  if (params.empty()) {
+    return path;
+  }
+
+  std::string result = path + "?";
+  for (size_t i = 0; i < params.size(); ++i) {
+    if (i > 0)
+      result += '&';
+    result += params[i];
+  }
+  return result;
 }
\ No newline at end of file
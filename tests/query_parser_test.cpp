@@ -0,0 +1,65 @@
+#include "../inc/query_parser.h"
+#include <algorithm>
+#include <iostream>
+
+static int failures = 0;
+
+static void expect(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "FAIL: " << what << std::endl;
+    ++failures;
+  }
+}
+
+static int depth(const IndexQuery &query) {
+  int deepest = 0;
+  for (const auto &child : query.children)
+    deepest = std::max(deepest, depth(child));
+  return deepest + 1;
+}
+
+static size_t nodes(const IndexQuery &query) {
+  size_t count = 1;
+  for (const auto &child : query.children)
+    count += nodes(child);
+  return count;
+}
+
+int main() {
+  expect(QueryParser::parse("(cake OR pie) AND apple").to_string() ==
+             QueryParser::parse("(cake OR pie) apple").to_string(),
+         "grouping");
+  expect(QueryParser::parse("((((cake))))").to_string() ==
+             QueryParser::parse("cake").to_string(),
+         "redundant parentheses");
+
+  // One request of 10,000 open parentheses used to overflow the stack.
+  IndexQuery deep = QueryParser::parse(std::string(10000, '(') + "cake");
+  expect(deep.terms_used() == std::vector<std::string>{"cake"},
+         "unclosed deep nesting keeps its word");
+  expect(depth(deep) <= 4 * QueryParser::kMaxDepth + 4,
+         "nesting depth is capped");
+
+  // Parentheses past the cap act as separators and still pair up.
+  std::string nested = std::string(40, '(') + "cake OR pie" +
+                       std::string(40, ')') + " apple";
+  expect(QueryParser::parse(nested).terms_used() ==
+             std::vector<std::string>({"apple", "cake", "pie"}),
+         "parentheses past the cap");
+
+  std::string words;
+  for (int i = 0; i < 20000; ++i)
+    words += "w" + std::to_string(i) + " ";
+  IndexQuery wide = QueryParser::parse(words);
+  expect(nodes(wide) <= 4 * QueryParser::kMaxTokens,
+         "node count is capped");
+  expect(wide.terms_used().size() == QueryParser::kMaxTokens,
+         "first kMaxTokens words kept");
+
+  if (failures) {
+    std::cerr << failures << " query parser checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "query parser checks passed" << std::endl;
+  return 0;
+}
\ No newline at end of file